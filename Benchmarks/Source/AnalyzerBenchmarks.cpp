@@ -0,0 +1,162 @@
+/*
+  ==============================================================================
+
+    Benchmarks of the analyzer: the audio thread's tap into it, and the
+    analysis job's work per window.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+#include "../../Source/PluginEditor.h"
+
+namespace
+{
+    //the analyzer tap as it was before it copied spans: a 2048 sample frame filled one setSample at a time,
+    //handed to a 30 slot fifo of AudioBuffers when full (kept here only to compare against)
+    struct PerSampleFifo
+    {
+        PerSampleFifo()
+        {
+            frame.setSize(1, frameSize);
+            for (auto& slot : slots)
+                slot.setSize(1, frameSize);
+        }
+
+        void update(const juce::AudioBuffer<float>& buffer, int channel)
+        {
+            auto* channelPtr = buffer.getReadPointer(channel);
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                pushNextSampleIntoFifo(channelPtr[i]);
+        }
+
+        //what the analyzer would do on its own thread, here so the fifo never fills up
+        void discardFrames() { fifo.reset(); }
+
+    private:
+        void pushNextSampleIntoFifo(float sample)
+        {
+            if (fifoIndex == frame.getNumSamples())
+            {
+                auto write = fifo.write(1);
+                if (write.blockSize1 > 0)
+                    slots[(size_t)write.startIndex1] = frame;
+                fifoIndex = 0;
+            }
+
+            frame.setSample(0, fifoIndex, sample);
+            ++fifoIndex;
+        }
+
+        static constexpr int frameSize = 2048;
+        juce::AudioBuffer<float> frame;
+        std::array<juce::AudioBuffer<float>, 30> slots;
+        juce::AbstractFifo fifo{ 30 };
+        int fifoIndex = 0;
+    };
+
+    //the post-FFT passes as they were before binsToDecibels: magnitudes (what performFrequencyOnlyForwardTransform
+    //adds after the transform), then normalise and drop inf/nan, then gainToDecibels (kept here only to compare against)
+    void threePassDecibels(const float* bins, float* decibels, int numBins, float negativeInfinity)
+    {
+        for (int i = 0; i < numBins; ++i)
+            decibels[i] = std::abs(std::complex<float>(bins[2 * i], bins[2 * i + 1]));
+
+        for (int i = 0; i < numBins; ++i)
+        {
+            auto v = decibels[i];
+            decibels[i] = !std::isinf(v) && !std::isnan(v) ? v / float(numBins) : 0.f;
+        }
+
+        for (int i = 0; i < numBins; ++i)
+            decibels[i] = juce::Decibels::gainToDecibels(decibels[i], negativeInfinity);
+    }
+}
+
+void runSampleFifoBenchmarks()
+{
+    Benchmark::printHeader("sample fifo: audio thread cost of the analyzer tap per block, left and right update");
+
+    for (auto blockSize : { 32, 64, 512, 2048 })
+    {
+        juce::AudioBuffer<float> block(2, blockSize);
+        Benchmark::fillWithNoise(block);
+
+        PerSampleFifo perSampleLeft, perSampleRight;
+        auto perSample = Benchmark::nanosecondsPerCall([&]
+        {
+            perSampleLeft.update(block, Channel::Left);
+            perSampleRight.update(block, Channel::Right);
+            perSampleLeft.discardFrames();
+            perSampleRight.discardFrames();
+        });
+
+        SingleChannelSampleFifo left{ Channel::Left }, right{ Channel::Right };
+        left.prepare(2048);
+        right.prepare(2048);
+        auto spanCopy = Benchmark::nanosecondsPerCall([&]
+        {
+            left.update(block);
+            right.update(block);
+            left.releaseSamples(left.getNumSamplesAvailable());
+            right.releaseSamples(right.getNumSamplesAvailable());
+        });
+
+        Benchmark::printResult(juce::String(blockSize) + " samples, per sample (before)", perSample);
+        Benchmark::printResult(juce::String(blockSize) + " samples, span copy (now)", spanCopy);
+    }
+}
+
+void runAnalyzerOrderBenchmarks()
+{
+    Benchmark::printHeader("orders: one analysis window per channel (window, FFT, decibels, fifo hand-off) per FFT order");
+
+    //one window's worth of noise at the biggest order, smaller orders read its newest samples like PathProducer does
+    juce::AudioBuffer<float> window(1, AnalyzerTransforms::getMaxFFTSize());
+    Benchmark::fillWithNoise(window);
+
+    FFTDataGenerator<std::vector<float>> generator;
+    std::vector<float> pulled(AnalyzerTransforms::getMaxFFTSize() / 2);
+
+    for (auto order : { order2048, order4096, order8192 })
+    {
+        generator.changeOrder(order);
+        auto nanoseconds = Benchmark::nanosecondsPerCall([&]
+        {
+            generator.produceFFTDataForRendering(window, -48.f);
+            generator.getFFTData(pulled);
+        });
+
+        auto fftSize = 1 << order;
+        //hops come every half window at 50% overlap, a quarter at 75%, at 48 kHz
+        auto windowsPerSecond = 48000.0 / (fftSize / 2);
+        Benchmark::printResult(juce::String(fftSize) + " points", nanoseconds);
+        Benchmark::printResult(juce::String(fftSize) + " points, 50% overlap, per second of audio", nanoseconds * windowsPerSecond);
+        Benchmark::printResult(juce::String(fftSize) + " points, 75% overlap, per second of audio", nanoseconds * windowsPerSecond * 2.0);
+    }
+}
+
+void runPostFFTBenchmarks()
+{
+    Benchmark::printHeader("post-FFT: bins to decibels, the old three passes vs the fused binsToDecibels, per window");
+
+    AnalyzerTransforms transforms;
+    juce::AudioBuffer<float> noise(1, AnalyzerTransforms::getMaxFFTSize());
+    Benchmark::fillWithNoise(noise);
+
+    for (auto order : { order2048, order4096, order8192 })
+    {
+        //real bins to work on: the noise windowed and transformed the way FFTDataGenerator does it
+        auto fftSize = 1 << order;
+        auto numBins = fftSize / 2;
+        std::vector<float> bins((size_t)fftSize * 2), decibels((size_t)numBins);
+        juce::FloatVectorOperations::multiply(bins.data(), noise.getReadPointer(0), transforms.getWindow(order), fftSize);
+        transforms.getFFT(order).performRealOnlyForwardTransform(bins.data(), true);
+
+        auto threePass = Benchmark::nanosecondsPerCall([&] { threePassDecibels(bins.data(), decibels.data(), numBins, -48.f); });
+        auto fused = Benchmark::nanosecondsPerCall([&] { AnalyzerTransforms::binsToDecibels(bins.data(), decibels.data(), numBins, -48.f); });
+
+        Benchmark::printResult(juce::String(fftSize) + " points, three passes (before)", threePass);
+        Benchmark::printResult(juce::String(fftSize) + " points, fused (now)", fused);
+    }
+}
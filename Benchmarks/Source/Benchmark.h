@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    Benchmark: timing helpers for the benchmark console app, and the groups
+    it runs. Each group lives in the .cpp of the area it measures and prints
+    its own table.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdio>
+#include "../../Source/PluginProcessor.h"
+
+namespace Benchmark
+{
+    //runs body until a timed batch lasts a quarter of a second, returns nanoseconds per call
+    //a few calls go first untimed, so caches and first touches don't count
+    template<typename Function>
+    double nanosecondsPerCall(Function&& body)
+    {
+        for (int i = 0; i < 16; ++i)
+            body();
+
+        for (int repetitions = 16;; repetitions *= 2)
+        {
+            auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < repetitions; ++i)
+                body();
+            auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            if (seconds > 0.25)
+                return seconds * 1.0e9 / repetitions;
+        }
+    }
+
+    inline void printHeader(const char* title) { std::printf("\n%s\n", title); }
+    inline void printResult(const juce::String& name, double nanoseconds) { std::printf("  %-48s %12.1f ns\n", name.toRawUTF8(), nanoseconds); }
+
+    //white noise at -12 dBFS, the same every run
+    template<typename SampleType>
+    void fillWithNoise(juce::AudioBuffer<SampleType>& buffer)
+    {
+        juce::Random random(1);
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            for (int n = 0; n < buffer.getNumSamples(); ++n)
+                buffer.setSample(ch, n, static_cast<SampleType>(0.25f * (2.f * random.nextFloat() - 1.f)));
+    }
+
+    //what every filter benchmark runs: both cuts at 48 dB/oct, a boosted peak and four extra bands,
+    //so nothing gets skipped as bypassed or flat
+    inline ChainSettings makeChainSettings()
+    {
+        ChainSettings settings;
+        settings.lowCutFreq = 40.f;
+        settings.lowCutSlope = Slope::Slope_48;
+        settings.highCutFreq = 12000.f;
+        settings.highCutSlope = Slope::Slope_48;
+        settings.peakFreq = 1000.f;
+        settings.peakGainInDecibels = 6.f;
+        settings.peakQuality = 1.f;
+
+        const BandType types[] = { BandType::BandLowShelf, BandType::BandPeak, BandType::BandPeak, BandType::BandHighShelf };
+        const float freqs[] = { 120.f, 400.f, 3000.f, 8000.f };
+        for (size_t i = 0; i < 4; ++i)
+            settings.extraBands[i] = { types[i], freqs[i], 3.f, 0.7f };
+
+        return settings;
+    }
+}
+
+//one per benchmarked area, see Main.cpp
+void runEngineBenchmarks();
+void runOversamplingBenchmarks();
+void runPrecisionBenchmarks();
+void runSampleFifoBenchmarks();
+void runAnalyzerOrderBenchmarks();
+void runPostFFTBenchmarks();
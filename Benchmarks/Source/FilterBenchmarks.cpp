@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    Benchmarks of the IIR path: FilterChains with the same designed set in
+    every configuration, so only the thing being compared changes.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+
+    ChainCoefficients designBenchmarkCoefficients(int oversamplingOrder)
+    {
+        auto settings = Benchmark::makeChainSettings();
+        settings.oversamplingOrder = oversamplingOrder;
+
+        ChainCoefficients coefficients;
+        designChainCoefficients(settings, sampleRate, ChainBands::AllBands, coefficients);
+        return coefficients;
+    }
+
+    //the way prepareToPlay and updateOversampling set the chains up, with the benchmark set designed for the factor
+    template<typename SampleType>
+    void prepareChains(FilterChains<SampleType>& chains, int numChannels, int blockSize, int oversamplingOrder = 0, int filterType = 0)
+    {
+        constexpr int maxOversamplingOrder = 2;
+        juce::dsp::ProcessSpec spec{ sampleRate, (juce::uint32)(blockSize << maxOversamplingOrder), 1 };
+        chains.prepare(spec, numChannels, blockSize, maxOversamplingOrder);
+        chains.applyCoefficients(designBenchmarkCoefficients(oversamplingOrder), ChainBands::AllBands, false);
+        chains.selectOversampler(oversamplingOrder, filterType);
+    }
+
+    //times one pass of the chains over a fresh copy of the source block, through the oversampler if one is selected
+    //the copy is in every configuration, it's a small part of 24 biquads per sample
+    template<typename SampleType, typename IOType>
+    double timeChains(FilterChains<SampleType>& chains, const juce::AudioBuffer<IOType>& source, bool useVectorChain)
+    {
+        juce::AudioBuffer<IOType> buffer(source.getNumChannels(), source.getNumSamples());
+        juce::ScopedNoDenormals noDenormals;
+
+        return Benchmark::nanosecondsPerCall([&]
+        {
+            buffer.makeCopyOf(source, true);
+            juce::dsp::AudioBlock<IOType> block(buffer);
+
+            //same as RomalEQAudioProcessor::processChains, the oversampler runs at the I/O precision
+            if constexpr (std::is_same_v<SampleType, IOType>)
+            {
+                if (auto* oversampler = chains.getOversampler())
+                {
+                    auto oversampledBlock = oversampler->processSamplesUp(block);
+                    chains.process(oversampledBlock, useVectorChain, false);
+                    oversampler->processSamplesDown(block);
+                    return;
+                }
+            }
+
+            chains.process(block, useVectorChain, false);
+        });
+    }
+}
+
+void runEngineBenchmarks()
+{
+    Benchmark::printHeader("engine: VectorChain vs one MonoChain per channel, float, 48 kHz, same designed set");
+
+    for (auto numChannels : { 1, 2, 6 })
+    {
+        for (auto blockSize : { 64, 512 })
+        {
+            FilterChains<float> chains;
+            prepareChains(chains, numChannels, blockSize);
+
+            juce::AudioBuffer<float> source(numChannels, blockSize);
+            Benchmark::fillWithNoise(source);
+
+            auto mono = timeChains(chains, source, false);
+            auto vector = timeChains(chains, source, true);
+            auto name = juce::String(numChannels) + " ch, " + juce::String(blockSize) + " samples";
+            Benchmark::printResult(name + ", MonoChains", mono);
+            Benchmark::printResult(name + ", VectorChain", vector);
+        }
+    }
+}
+
+void runOversamplingBenchmarks()
+{
+    Benchmark::printHeader("oversampling: FilterChains per factor and filter type, float, stereo, 48 kHz, 512 samples, VectorChain");
+
+    constexpr int numChannels = 2, blockSize = 512;
+    juce::AudioBuffer<float> source(numChannels, blockSize);
+    Benchmark::fillWithNoise(source);
+
+    const char* filterNames[] = { "polyphase IIR", "equiripple FIR" };
+    for (int order = 0; order <= 2; ++order)
+    {
+        for (int filterType = 0; filterType < 2; ++filterType)
+        {
+            //no oversampler, no filter type to tell apart
+            if (order == 0 && filterType == 1)
+                continue;
+
+            FilterChains<float> chains;
+            prepareChains(chains, numChannels, blockSize, order, filterType);
+
+            auto name = juce::String(1 << order) + "x" + (order > 0 ? juce::String(", ") + filterNames[filterType] : juce::String());
+            Benchmark::printResult(name, timeChains(chains, source, true));
+        }
+    }
+}
+
+void runPrecisionBenchmarks()
+{
+    Benchmark::printHeader("precision: the three \"Filter Precision\" modes, stereo, 48 kHz, 512 samples");
+
+    constexpr int numChannels = 2, blockSize = 512;
+    juce::AudioBuffer<float> floatSource(numChannels, blockSize);
+    juce::AudioBuffer<double> doubleSource(numChannels, blockSize);
+    Benchmark::fillWithNoise(floatSource);
+    Benchmark::fillWithNoise(doubleSource);
+
+    FilterChains<float> floatChains;
+    FilterChains<double> doubleChains;
+    prepareChains(floatChains, numChannels, blockSize);
+    prepareChains(doubleChains, numChannels, blockSize);
+
+    for (auto useVectorChain : { true, false })
+    {
+        juce::String engine = useVectorChain ? ", VectorChain" : ", MonoChains";
+        Benchmark::printResult("single (float I/O, float filters)" + engine, timeChains(floatChains, floatSource, useVectorChain));
+        Benchmark::printResult("mixed (float I/O, double filters)" + engine, timeChains(doubleChains, floatSource, useVectorChain));
+        Benchmark::printResult("double (double I/O, double filters)" + engine, timeChains(doubleChains, doubleSource, useVectorChain));
+    }
+}
@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    Benchmark console app: runs every group, or only the ones named on the
+    command line, e.g. "RomalEQBenchmarks engine".
+
+    Build it in Release, the numbers only mean something with optimisations on.
+
+  ==============================================================================
+*/
+
+#include "Benchmark.h"
+
+int main(int argc, char* argv[])
+{
+    struct Group
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Group groups[] = {
+        { "engine", runEngineBenchmarks },
+        { "oversampling", runOversamplingBenchmarks },
+        { "precision", runPrecisionBenchmarks },
+        { "fifo", runSampleFifoBenchmarks },
+        { "orders", runAnalyzerOrderBenchmarks },
+        { "postfft", runPostFFTBenchmarks },
+    };
+
+    juce::StringArray requested;
+    for (int i = 1; i < argc; ++i)
+        requested.add(argv[i]);
+
+    for (const auto& group : groups)
+        if (requested.isEmpty() || requested.contains(group.name))
+            group.run();
+
+    return 0;
+}
@@ -0,0 +1,510 @@
+/*
+  ==============================================================================
+
+    Plain coefficient storage for the EQ chain.
+
+    Everything in here is a fixed size value type, so it can be designed on one
+    thread and handed to the audio thread without allocating or ref counting.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <complex>
+#include <limits>
+
+enum Slope {
+    Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48
+};
+
+//define chain Positions
+//lowcut, peak and highcut plus this many bands of selectable type, 24 in total
+static constexpr int maxExtraBands = 21;
+
+//ends of every frequency parameter's range, a cut parked there counts as off
+static constexpr float minimumFrequency = 20.f, maximumFrequency = 20000.f;
+
+enum ChainPositions {
+    LowCut,
+    Peak,
+    HighCut,
+    FirstExtraBand, //extra band i sits at FirstExtraBand + i
+    //mid/side mode: the side channel's own lowcut, peak and highcut (the extra bands are shared)
+    SideLowCut = FirstExtraBand + maxExtraBands,
+    SidePeak,
+    SideHighCut
+};
+
+static constexpr int numChainBands = ChainPositions::SideHighCut + 1;
+//bands in one designed set (the side set uses the main positions)
+static constexpr int numSetBands = ChainPositions::SideLowCut;
+
+//bit per chain position, so we can say which bands need redesigning
+enum ChainBands {
+    LowCutBand = 1 << ChainPositions::LowCut,
+    PeakBand = 1 << ChainPositions::Peak,
+    HighCutBand = 1 << ChainPositions::HighCut,
+    ExtraBands = ((1 << maxExtraBands) - 1) << ChainPositions::FirstExtraBand,
+    SideLowCutBand = 1 << ChainPositions::SideLowCut,
+    SidePeakBand = 1 << ChainPositions::SidePeak,
+    SideHighCutBand = 1 << ChainPositions::SideHighCut,
+    SideBands = SideLowCutBand | SidePeakBand | SideHighCutBand,
+    AllBands = LowCutBand | PeakBand | HighCutBand | ExtraBands | SideBands
+};
+
+//the side chain is a complete set of its own, designed from the side lowcut / peak / highcut
+//so a side band bit maps onto the matching main band bit of that set
+inline int getSideBandsAsMainBands(int bands) { return (bands & ChainBands::SideBands) >> ChainPositions::SideLowCut; }
+
+inline int getExtraBandBit(int extraBandIndex) { return 1 << (ChainPositions::FirstExtraBand + extraBandIndex); }
+
+//what an extra band does, BandOff bands are skipped entirely
+enum BandType {
+    BandOff,
+    BandPeak,
+    BandLowShelf,
+    BandHighShelf,
+    BandNotch,
+    BandLowPass,
+    BandHighPass
+};
+
+//normalised biquad, same layout JUCE uses internally: b0, b1, b2, a1, a2 (a0 == 1)
+template<typename SampleType>
+struct BiquadCoefficients
+{
+    SampleType b0{ 1 }, b1{ 0 }, b2{ 0 }, a1{ 0 }, a2{ 0 };
+};
+
+//the section with its output mixed back with its input, wet = 0 being exactly unity
+//only the numerator moves (towards the denominator), so the poles and the filter state stay valid throughout
+template<typename SampleType>
+BiquadCoefficients<SampleType> withWetLevel(const BiquadCoefficients<SampleType>& c, SampleType wet)
+{
+    BiquadCoefficients<SampleType> result = c;
+    result.b0 = 1 + wet * (c.b0 - 1);
+    result.b1 = c.a1 + wet * (c.b1 - c.a1);
+    result.b2 = c.a2 + wet * (c.b2 - c.a2);
+    return result;
+}
+
+//the gain independent part of the RBJ peak, so the gain can be moved without redoing any trig (dynamic eq)
+struct PeakPrototype
+{
+    double alpha{ 0 }, c2{ -2 };
+
+    //same as juce::dsp::IIR::Coefficients::makePeakFilter, a handful of multiplies and one divide
+    template<typename SampleType>
+    BiquadCoefficients<SampleType> withGain(double gainFactor) const
+    {
+        auto A = std::sqrt(juce::jmax(gainFactor, 0.0));
+        auto alphaTimesA = alpha * A;
+        auto alphaOverA = alpha / A;
+        auto a0Inverse = 1.0 / (1.0 + alphaOverA);
+
+        BiquadCoefficients<SampleType> result;
+        result.b0 = static_cast<SampleType>((1.0 + alphaTimesA) * a0Inverse);
+        result.b1 = static_cast<SampleType>(c2 * a0Inverse);
+        result.b2 = static_cast<SampleType>((1.0 - alphaTimesA) * a0Inverse);
+        result.a1 = static_cast<SampleType>(c2 * a0Inverse);
+        result.a2 = static_cast<SampleType>((1.0 - alphaOverA) * a0Inverse);
+        return result;
+    }
+};
+
+//one complete set of coefficients for lowcut -> peak -> extra bands -> highcut
+//each band carries a version number so whoever applies the set can skip bands it already has
+//kept in double so the double chains get the full precision, float chains round when they apply a set
+struct ChainCoefficients
+{
+    static constexpr int maxCutStages = 4;
+
+    std::array<BiquadCoefficients<double>, maxCutStages> lowCut, highCut;
+    BiquadCoefficients<double> peak;
+
+    //what the peak was designed from, lets the dynamic band re-gain it cheaply
+    PeakPrototype peakPrototype;
+    float peakGainInDecibels{ 0 };
+    //band-pass at the peak's frequency and Q, designed at the plugin rate (the detector never gets oversampled)
+    BiquadCoefficients<double> peakDetector;
+
+    //only the first (slope + 1) cut stages are meaningful
+    Slope lowCutSlope{ Slope::Slope_12 }, highCutSlope{ Slope::Slope_12 };
+    bool lowCutBypassed{ false }, peakBypassed{ false }, highCutBypassed{ false };
+
+    //extra bands, only the ones with bandActive set are meaningful
+    std::array<BiquadCoefficients<double>, maxExtraBands> extraBands;
+    std::array<bool, maxExtraBands> extraBandActive{};
+
+    //indexed by ChainPositions (extra band i at FirstExtraBand + i)
+    std::array<juce::uint32, numChainBands> bandVersions{};
+
+    //designed for sampleRate * 2^oversamplingOrder, whoever runs the set has to run it at that rate
+    int oversamplingOrder{ 0 };
+};
+
+//is the band at position (ChainPositions, main set positions only) running in this set
+inline bool isBandActive(const ChainCoefficients& coefficients, int position)
+{
+    switch (position)
+    {
+        case ChainPositions::LowCut: return !coefficients.lowCutBypassed;
+        case ChainPositions::Peak: return !coefficients.peakBypassed;
+        case ChainPositions::HighCut: return !coefficients.highCutBypassed;
+        default: return coefficients.extraBandActive[static_cast<size_t>(position - ChainPositions::FirstExtraBand)];
+    }
+}
+
+inline bool hasActiveBands(const ChainCoefficients& coefficients)
+{
+    for (int position = 0; position < numSetBands; ++position)
+        if (isBandActive(coefficients, position))
+            return true;
+    return false;
+}
+
+//copies the given bands (ChainBands mask, main set positions) from one set to another, versions included
+inline void copyBands(const ChainCoefficients& source, ChainCoefficients& destination, int bands)
+{
+    if (bands & ChainBands::LowCutBand)
+    {
+        destination.lowCut = source.lowCut;
+        destination.lowCutSlope = source.lowCutSlope;
+        destination.lowCutBypassed = source.lowCutBypassed;
+    }
+
+    if (bands & ChainBands::PeakBand)
+    {
+        destination.peak = source.peak;
+        destination.peakPrototype = source.peakPrototype;
+        destination.peakGainInDecibels = source.peakGainInDecibels;
+        destination.peakDetector = source.peakDetector;
+        destination.peakBypassed = source.peakBypassed;
+    }
+
+    if (bands & ChainBands::HighCutBand)
+    {
+        destination.highCut = source.highCut;
+        destination.highCutSlope = source.highCutSlope;
+        destination.highCutBypassed = source.highCutBypassed;
+    }
+
+    for (int i = 0; i < maxExtraBands; ++i)
+    {
+        if (bands & getExtraBandBit(i))
+        {
+            destination.extraBands[(size_t)i] = source.extraBands[(size_t)i];
+            destination.extraBandActive[(size_t)i] = source.extraBandActive[(size_t)i];
+        }
+    }
+
+    for (size_t i = 0; i < (size_t)numSetBands; ++i)
+        if (bands & (1 << i))
+            destination.bandVersions[i] = source.bandVersions[i];
+}
+
+inline void setBandActive(ChainCoefficients& coefficients, int position, bool shouldBeActive)
+{
+    switch (position)
+    {
+        case ChainPositions::LowCut: coefficients.lowCutBypassed = !shouldBeActive; break;
+        case ChainPositions::Peak: coefficients.peakBypassed = !shouldBeActive; break;
+        case ChainPositions::HighCut: coefficients.highCutBypassed = !shouldBeActive; break;
+        default: coefficients.extraBandActive[static_cast<size_t>(position - ChainPositions::FirstExtraBand)] = shouldBeActive; break;
+    }
+}
+
+//switches the band at position on, with every stage it runs at wet level (see withWetLevel)
+inline void setBandWetLevel(ChainCoefficients& coefficients, int position, double wet)
+{
+    setBandActive(coefficients, position, true);
+    switch (position)
+    {
+        case ChainPositions::LowCut:
+            for (auto& section : coefficients.lowCut)
+                section = withWetLevel(section, wet);
+            break;
+
+        case ChainPositions::Peak:
+            coefficients.peak = withWetLevel(coefficients.peak, wet);
+            break;
+
+        case ChainPositions::HighCut:
+            for (auto& section : coefficients.highCut)
+                section = withWetLevel(section, wet);
+            break;
+
+        default:
+        {
+            auto& band = coefficients.extraBands[static_cast<size_t>(position - ChainPositions::FirstExtraBand)];
+            band = withWetLevel(band, wet);
+            break;
+        }
+    }
+}
+
+//rate the chains actually run at for a given oversampling order (0 = off, 1 = 2x, 2 = 4x)
+inline double getOversampledRate(double sampleRate, int oversamplingOrder)
+{
+    return sampleRate * (1 << oversamplingOrder);
+}
+
+//closed form versions of the JUCE designs we use, written straight into BiquadCoefficients
+//no allocation, so these are safe to call on the audio thread (e.g. once per smoothing sub-block)
+
+inline PeakPrototype designPeakPrototype(double sampleRate, double frequency, double Q)
+{
+    jassert(sampleRate > 0.0 && frequency > 0.0 && frequency <= sampleRate * 0.5 && Q > 0.0);
+
+    auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    return { std::sin(omega) / (Q * 2.0), -2.0 * std::cos(omega) };
+}
+
+//same as juce::dsp::IIR::Coefficients::makePeakFilter
+template<typename SampleType>
+BiquadCoefficients<SampleType> designPeak(double sampleRate, double frequency, double Q, double gainFactor)
+{
+    return designPeakPrototype(sampleRate, frequency, Q).withGain<SampleType>(gainFactor);
+}
+
+//divides everything by a0, the same way juce::dsp::IIR::Coefficients does
+template<typename SampleType>
+BiquadCoefficients<SampleType> makeNormalisedBiquad(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    auto a0Inverse = 1.0 / a0;
+
+    BiquadCoefficients<SampleType> result;
+    result.b0 = static_cast<SampleType>(b0 * a0Inverse);
+    result.b1 = static_cast<SampleType>(b1 * a0Inverse);
+    result.b2 = static_cast<SampleType>(b2 * a0Inverse);
+    result.a1 = static_cast<SampleType>(a1 * a0Inverse);
+    result.a2 = static_cast<SampleType>(a2 * a0Inverse);
+    return result;
+}
+
+//same as the matching juce::dsp::IIR::Coefficients::make... for every BandType
+//gainFactor is only used by the peak and the shelves, BandOff gives a unity biquad
+template<typename SampleType>
+BiquadCoefficients<SampleType> designBand(BandType type, double sampleRate, double frequency, double Q, double gainFactor)
+{
+    jassert(sampleRate > 0.0 && frequency > 0.0 && frequency <= sampleRate * 0.5 && Q > 0.0);
+
+    switch (type)
+    {
+        case BandPeak:
+            return designPeak<SampleType>(sampleRate, frequency, Q, gainFactor);
+
+        case BandLowShelf:
+        case BandHighShelf:
+        {
+            auto A = std::sqrt(juce::jmax(gainFactor, 0.0));
+            auto aminus1 = A - 1.0;
+            auto aplus1 = A + 1.0;
+            auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+            auto coso = std::cos(omega);
+            auto beta = std::sin(omega) * std::sqrt(A) / Q;
+            auto aminus1TimesCoso = aminus1 * coso;
+
+            if (type == BandLowShelf)
+                return makeNormalisedBiquad<SampleType>(A * (aplus1 - aminus1TimesCoso + beta),
+                                                        A * 2.0 * (aminus1 - aplus1 * coso),
+                                                        A * (aplus1 - aminus1TimesCoso - beta),
+                                                        aplus1 + aminus1TimesCoso + beta,
+                                                        -2.0 * (aminus1 + aplus1 * coso),
+                                                        aplus1 + aminus1TimesCoso - beta);
+
+            return makeNormalisedBiquad<SampleType>(A * (aplus1 + aminus1TimesCoso + beta),
+                                                    A * -2.0 * (aminus1 + aplus1 * coso),
+                                                    A * (aplus1 + aminus1TimesCoso - beta),
+                                                    aplus1 - aminus1TimesCoso + beta,
+                                                    2.0 * (aminus1 - aplus1 * coso),
+                                                    aplus1 - aminus1TimesCoso - beta);
+        }
+
+        case BandNotch:
+        case BandLowPass:
+        {
+            auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+            auto nSquared = n * n;
+            auto invQ = 1.0 / Q;
+
+            if (type == BandNotch)
+                return makeNormalisedBiquad<SampleType>(1.0 + nSquared, 2.0 * (1.0 - nSquared), 1.0 + nSquared,
+                                                        1.0 + n * invQ + nSquared, 2.0 * (1.0 - nSquared), 1.0 - n * invQ + nSquared);
+
+            return makeNormalisedBiquad<SampleType>(1.0, 2.0, 1.0,
+                                                    1.0 + invQ * n + nSquared, 2.0 * (1.0 - nSquared), 1.0 - invQ * n + nSquared);
+        }
+
+        case BandHighPass:
+        {
+            auto n = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+            auto nSquared = n * n;
+            auto invQ = 1.0 / Q;
+
+            return makeNormalisedBiquad<SampleType>(1.0, -2.0, 1.0,
+                                                    1.0 + invQ * n + nSquared, 2.0 * (nSquared - 1.0), 1.0 - invQ * n + nSquared);
+        }
+
+        case BandOff:
+        default:
+            return {};
+    }
+}
+
+//same as juce::dsp::IIR::Coefficients::makeBandPass, 0dB at the centre frequency
+template<typename SampleType>
+BiquadCoefficients<SampleType> designBandPass(double sampleRate, double frequency, double Q)
+{
+    auto prototype = designPeakPrototype(sampleRate, frequency, Q);
+    auto a0Inverse = 1.0 / (1.0 + prototype.alpha);
+
+    BiquadCoefficients<SampleType> result;
+    result.b0 = static_cast<SampleType>(prototype.alpha * a0Inverse);
+    result.b1 = static_cast<SampleType>(0);
+    result.b2 = static_cast<SampleType>(-prototype.alpha * a0Inverse);
+    result.a1 = static_cast<SampleType>(prototype.c2 * a0Inverse);
+    result.a2 = static_cast<SampleType>((1.0 - prototype.alpha) * a0Inverse);
+    return result;
+}
+
+//same as FilterDesign::designIIRHighpassHighOrderButterworthMethod / designIIRLowpassHighOrderButterworthMethod
+//with order = (slope + 1) * 2, fills the first (slope + 1) sections of sections
+template<typename SampleType, size_t MaxSections>
+void designButterworthCut(double sampleRate, double frequency, Slope slope, bool isHighpass,
+                          std::array<BiquadCoefficients<SampleType>, MaxSections>& sections)
+{
+    jassert(sampleRate > 0.0 && frequency > 0.0 && frequency <= sampleRate * 0.5);
+
+    auto numSections = static_cast<int>(slope) + 1;
+    auto order = numSections * 2;
+    jassert(numSections <= static_cast<int>(MaxSections));
+
+    //every section shares the prewarped cutoff, only the Q differs
+    //(juce uses tan for the highpass and 1 / tan for the lowpass)
+    auto t = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+    auto n = isHighpass ? t : 1.0 / t;
+    auto nSquared = n * n;
+
+    for (int i = 0; i < numSections; ++i)
+    {
+        auto Q = 1.0 / (2.0 * std::cos((2.0 * i + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+        auto invQ = 1.0 / Q;
+        auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+        auto& section = sections[static_cast<size_t>(i)];
+        if (isHighpass)
+        {
+            section.b0 = static_cast<SampleType>(c1);
+            section.b1 = static_cast<SampleType>(c1 * -2.0);
+            section.b2 = static_cast<SampleType>(c1);
+            section.a1 = static_cast<SampleType>(c1 * 2.0 * (nSquared - 1.0));
+        }
+        else
+        {
+            section.b0 = static_cast<SampleType>(c1);
+            section.b1 = static_cast<SampleType>(c1 * 2.0);
+            section.b2 = static_cast<SampleType>(c1);
+            section.a1 = static_cast<SampleType>(c1 * 2.0 * (1.0 - nSquared));
+        }
+        section.a2 = static_cast<SampleType>(c1 * (1.0 - invQ * n + nSquared));
+    }
+}
+
+//|H(e^jw)| of one section at frequency, sampleRate being the rate the section was designed for
+template<typename SampleType>
+double getMagnitudeForFrequency(const BiquadCoefficients<SampleType>& c, double frequency, double sampleRate)
+{
+    auto omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+    auto z1 = std::polar(1.0, -omega);
+    auto z2 = z1 * z1;
+
+    auto numerator = (double)c.b0 + (double)c.b1 * z1 + (double)c.b2 * z2;
+    auto denominator = 1.0 + (double)c.a1 * z1 + (double)c.a2 * z2;
+    return std::abs(numerator / denominator);
+}
+
+//magnitude of the whole cascade, skipping bypassed / off bands and unused cut stages
+//sampleRate is the plugin rate, the oversampling order the set was designed for is taken care of here
+inline double getChainMagnitudeForFrequency(const ChainCoefficients& coefficients, double frequency, double sampleRate)
+{
+    auto designRate = getOversampledRate(sampleRate, coefficients.oversamplingOrder);
+    auto magnitude = 1.0;
+
+    if (!coefficients.lowCutBypassed)
+        for (int i = 0; i <= static_cast<int>(coefficients.lowCutSlope); ++i)
+            magnitude *= getMagnitudeForFrequency(coefficients.lowCut[static_cast<size_t>(i)], frequency, designRate);
+
+    if (!coefficients.peakBypassed)
+        magnitude *= getMagnitudeForFrequency(coefficients.peak, frequency, designRate);
+
+    for (size_t i = 0; i < coefficients.extraBands.size(); ++i)
+        if (coefficients.extraBandActive[i])
+            magnitude *= getMagnitudeForFrequency(coefficients.extraBands[i], frequency, designRate);
+
+    if (!coefficients.highCutBypassed)
+        for (int i = 0; i <= static_cast<int>(coefficients.highCutSlope); ++i)
+            magnitude *= getMagnitudeForFrequency(coefficients.highCut[static_cast<size_t>(i)], frequency, designRate);
+
+    return magnitude;
+}
+
+//samples it takes whatever one section holds to die away to level (a fraction of the input)
+//an impulse response is a sum of pole powers, so the pole closest to the unit circle decides
+//the state can hold up to the section's peak gain times the input (a sine sat on a resonance), so the decay starts from there
+template<typename SampleType>
+double getDecaySamples(const BiquadCoefficients<SampleType>& c, double level)
+{
+    auto a1 = (double)c.a1, a2 = (double)c.a2;
+    auto discriminant = a1 * a1 - 4.0 * a2;
+
+    //complex pair: both poles have radius sqrt(a2), real poles: take the larger of the two
+    auto radius = discriminant < 0.0 ? std::sqrt(a2)
+                                     : 0.5 * juce::jmax(std::abs(-a1 + std::sqrt(discriminant)), std::abs(-a1 - std::sqrt(discriminant)));
+
+    //the numerator alone lasts 3 samples, and a pole on (or outside) the unit circle never dies away
+    if (radius < 1.0e-9)
+        return 3.0;
+    if (radius >= 1.0)
+        return std::numeric_limits<double>::infinity();
+
+    //the peak is at dc, nyquist or near the pole angle, and x2 covers how far off the pole angle it can sit
+    auto peakGain = juce::jmax(1.0, getMagnitudeForFrequency(c, 0.0, 1.0), getMagnitudeForFrequency(c, 0.5, 1.0));
+    if (discriminant < 0.0)
+    {
+        auto poleAngle = std::acos(juce::jlimit(-1.0, 1.0, -a1 / (2.0 * radius)));
+        peakGain = juce::jmax(peakGain, getMagnitudeForFrequency(c, poleAngle / juce::MathConstants<double>::twoPi, 1.0));
+    }
+
+    return 3.0 + std::log(level / (2.0 * peakGain)) / std::log(radius);
+}
+
+//seconds for the whole cascade to die away to level, skipping bypassed / off bands and unused cut stages
+//the sections run one after the other, so adding their decay times up gives a safe upper bound
+inline double getChainDecaySeconds(const ChainCoefficients& coefficients, double level, double sampleRate)
+{
+    auto samples = 0.0;
+
+    if (!coefficients.lowCutBypassed)
+        for (int i = 0; i <= static_cast<int>(coefficients.lowCutSlope); ++i)
+            samples += getDecaySamples(coefficients.lowCut[static_cast<size_t>(i)], level);
+
+    if (!coefficients.peakBypassed)
+        samples += getDecaySamples(coefficients.peak, level);
+
+    for (size_t i = 0; i < coefficients.extraBands.size(); ++i)
+        if (coefficients.extraBandActive[i])
+            samples += getDecaySamples(coefficients.extraBands[i], level);
+
+    if (!coefficients.highCutBypassed)
+        for (int i = 0; i <= static_cast<int>(coefficients.highCutSlope); ++i)
+            samples += getDecaySamples(coefficients.highCut[static_cast<size_t>(i)], level);
+
+    return samples / getOversampledRate(sampleRate, coefficients.oversamplingOrder);
+}
@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    CutFilterTable: the butterworth lowcut / highcut sections for every slope,
+    designed up front on a 1/96 octave grid of cutoffs.
+
+    A butterworth design only depends on cutoff / sample rate, so one table
+    covers the plugin rate and every oversampled rate. Looking a cutoff up
+    interpolates between the two nearest grid points, which makes moving a cut
+    a lookup and a lerp instead of a design.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "ChainCoefficients.h"
+
+class CutFilterTable
+{
+public:
+    //allocates, call it while nothing is looking anything up
+    //covers the whole frequency parameter range at sampleRate times 1 to 2^maxOversamplingOrder
+    void prepare(double sampleRate, int maxOversamplingOrder)
+    {
+        auto lowest = minimumFrequency / getOversampledRate(sampleRate, maxOversamplingOrder);
+        auto highest = juce::jmin(maximumFrequency / sampleRate, maximumNormalisedCutoff);
+        if (lowest == lowestCutoff && highest == highestCutoff)
+            return;
+
+        lowestCutoff = lowest;
+        highestCutoff = highest;
+        numPoints = 2 + (int)std::ceil(std::log2(highestCutoff / lowestCutoff) * stepsPerOctave);
+        sections.resize((size_t)(2 * numPoints * sectionsPerPoint));
+
+        std::array<BiquadCoefficients<double>, ChainCoefficients::maxCutStages> designed;
+        for (int isHighpass = 0; isHighpass < 2; ++isHighpass)
+        {
+            for (int point = 0; point < numPoints; ++point)
+            {
+                //the last point can sit up to one step past highestCutoff, still well short of nyquist
+                auto cutoff = lowestCutoff * std::exp2((double)point / stepsPerOctave);
+                for (int slope = 0; slope < numSlopes; ++slope)
+                {
+                    designButterworthCut(1.0, cutoff, static_cast<Slope>(slope), isHighpass == 1, designed);
+                    std::copy(designed.begin(), designed.begin() + slope + 1, getSections(isHighpass == 1, point, static_cast<Slope>(slope)));
+                }
+            }
+        }
+    }
+
+    //same as designButterworthCut, falls back to it for cutoffs the table doesn't cover
+    //a lerp between two stable sections is stable too: the region of stable (a1, a2) is a triangle, so it's convex
+    template<typename SampleType>
+    void lookup(double sampleRate, double frequency, Slope slope, bool isHighpass,
+                std::array<BiquadCoefficients<SampleType>, ChainCoefficients::maxCutStages>& result) const
+    {
+        auto cutoff = frequency / sampleRate;
+        if (numPoints == 0 || cutoff < lowestCutoff || cutoff > highestCutoff)
+        {
+            designButterworthCut(sampleRate, frequency, slope, isHighpass, result);
+            return;
+        }
+
+        auto position = std::log2(cutoff / lowestCutoff) * stepsPerOctave;
+        auto point = juce::jlimit(0, numPoints - 2, (int)position);
+        auto fraction = position - point;
+
+        const auto* below = getSections(isHighpass, point, slope);
+        const auto* above = getSections(isHighpass, point + 1, slope);
+        for (int i = 0; i <= static_cast<int>(slope); ++i)
+        {
+            auto& section = result[static_cast<size_t>(i)];
+            section.b0 = static_cast<SampleType>(below[i].b0 + fraction * (above[i].b0 - below[i].b0));
+            section.b1 = static_cast<SampleType>(below[i].b1 + fraction * (above[i].b1 - below[i].b1));
+            section.b2 = static_cast<SampleType>(below[i].b2 + fraction * (above[i].b2 - below[i].b2));
+            section.a1 = static_cast<SampleType>(below[i].a1 + fraction * (above[i].a1 - below[i].a1));
+            section.a2 = static_cast<SampleType>(below[i].a2 + fraction * (above[i].a2 - below[i].a2));
+        }
+    }
+
+private:
+    //slope n has n + 1 sections, they're stored back to back: 1 + 2 + 3 + 4 per grid point
+    static constexpr int numSlopes = 4;
+    static constexpr int sectionsPerPoint = numSlopes * (numSlopes + 1) / 2;
+
+    static int getFirstSection(Slope slope)
+    {
+        auto s = static_cast<int>(slope);
+        return s * (s + 1) / 2;
+    }
+
+    BiquadCoefficients<double>* getSections(bool isHighpass, int point, Slope slope)
+    {
+        return sections.data() + ((isHighpass ? numPoints : 0) + point) * sectionsPerPoint + getFirstSection(slope);
+    }
+
+    const BiquadCoefficients<double>* getSections(bool isHighpass, int point, Slope slope) const
+    {
+        return sections.data() + ((isHighpass ? numPoints : 0) + point) * sectionsPerPoint + getFirstSection(slope);
+    }
+
+    //1/96 octave is 12.5 cents, close enough that the lerp can't be told apart from the real design
+    static constexpr int stepsPerOctave = 96;
+    //the prewarping gets steep towards nyquist, cutoffs past this are designed directly
+    static constexpr double maximumNormalisedCutoff = 0.45;
+
+    double lowestCutoff = 0.0, highestCutoff = 0.0;
+    int numPoints = 0;
+    std::vector<BiquadCoefficients<double>> sections;
+};
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    LatestValue: single writer / single reader mailbox that only ever hands
+    over the most recent value.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//wait-free "latest value" mailbox (triple buffer) for one writer thread and one reader thread
+//the writer fills getWriteBuffer() and publishes it, the reader only ever sees complete values
+//if the writer is faster than the reader the in between values are simply skipped
+template<typename T>
+struct LatestValue
+{
+    //fills every slot with initialValue (e.g. preallocated storage) and forgets anything published
+    //only while neither side is running
+    void prepare(const T& initialValue)
+    {
+        for (auto& buffer : buffers)
+            buffer = initialValue;
+
+        writeIndex = 0;
+        readIndex = 1;
+        state.store(2);
+    }
+
+    T& getWriteBuffer() { return buffers[writeIndex]; }
+
+    void publish()
+    {
+        writeIndex = state.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    bool isNewValueAvailable() const
+    {
+        return (state.load(std::memory_order_relaxed) & newDataFlag) != 0;
+    }
+
+    //true if something was published since the last pull, getReadBuffer() then holds it
+    bool pull()
+    {
+        if (!isNewValueAvailable())
+            return false;
+
+        readIndex = state.exchange(readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& getReadBuffer() const { return buffers[readIndex]; }
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+    std::array<T, 3> buffers;
+    int writeIndex = 0, readIndex = 1;
+    std::atomic<int> state{ 2 };
+};
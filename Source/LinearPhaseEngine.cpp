@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine: runs the EQ as one long symmetric FIR instead of the
+    IIR cascade, so every band is linear phase.
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+void LinearPhaseEngine::prepare(double newSampleRate, int numChannels)
+{
+    sampleRate = newSampleRate;
+    kernelSize = juce::jmax(fftSize, juce::nextPowerOfTwo(juce::roundToInt(sampleRate * kernelLengthSeconds)));
+    numPartitions = kernelSize / partitionSize;
+
+    convolutionFFT = std::make_unique<juce::dsp::FFT>(juce::findHighestSetBit((juce::uint32)fftSize));
+    partitionFFT = std::make_unique<juce::dsp::FFT>(juce::findHighestSetBit((juce::uint32)fftSize));
+    kernelFFT = std::make_unique<juce::dsp::FFT>(juce::findHighestSetBit((juce::uint32)kernelSize));
+
+    channels.resize((size_t)juce::jmax(1, numChannels));
+    for (auto& state : channels)
+    {
+        state.inputWindow.assign(fftSize, 0.f);
+        state.output.assign(partitionSize, 0.f);
+        state.fadeOutput.assign(partitionSize, 0.f);
+        state.inputSpectra.assign((size_t)(numPartitions * numBins), {});
+    }
+
+    //juce's real only FFTs want room for size complex values
+    convolutionScratch.assign(fftSize, {});
+    partitionScratch.assign(fftSize, {});
+    kernelScratch.assign((size_t)kernelSize, {});
+
+    //symmetric around kernelSize / 2, the last point is dropped so the kernel stays a power of two long
+    window.resize((size_t)kernelSize + 1);
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), window.size(),
+        juce::dsp::WindowingFunction<float>::hann, false);
+    kernel.assign((size_t)kernelSize, 0.f);
+
+    //a unit impulse at the centre has the same latency as any real kernel, so switching in later is seamless
+    kernel[(size_t)kernelSize / 2] = 1.f;
+    KernelSpectra delay((size_t)(numPartitions * numBins));
+    transformKernel(delay);
+    kernels.prepare(delay);
+
+    reset();
+}
+
+void LinearPhaseEngine::reset()
+{
+    for (auto& state : channels)
+    {
+        std::fill(state.inputWindow.begin(), state.inputWindow.end(), 0.f);
+        std::fill(state.output.begin(), state.output.end(), 0.f);
+        std::fill(state.fadeOutput.begin(), state.fadeOutput.end(), 0.f);
+        std::fill(state.inputSpectra.begin(), state.inputSpectra.end(), std::complex<float>());
+    }
+
+    fifoPosition = 0;
+    delayLineIndex = 0;
+}
+
+void LinearPhaseEngine::buildKernel(const ChainCoefficients& coefficients)
+{
+    //zero phase spectrum straight from the magnitude response, mirrored so it's real and symmetric
+    auto halfSize = kernelSize / 2;
+    for (int bin = 0; bin <= halfSize; ++bin)
+    {
+        auto magnitude = (float)getChainMagnitudeForFrequency(coefficients, bin * sampleRate / kernelSize, sampleRate);
+        kernelScratch[(size_t)bin] = magnitude;
+        if (bin > 0 && bin < halfSize)
+            kernelScratch[(size_t)(kernelSize - bin)] = magnitude;
+    }
+
+    kernelFFT->performRealOnlyInverseTransform(reinterpret_cast<float*>(kernelScratch.data()));
+
+    //the zero phase impulse wraps around index 0, rotating it to the centre makes it causal and linear phase
+    auto* impulse = reinterpret_cast<const float*>(kernelScratch.data());
+    for (int n = 0; n < kernelSize; ++n)
+        kernel[(size_t)n] = impulse[(n + halfSize) % kernelSize] * window[(size_t)n];
+
+    transformKernel(kernels.getWriteBuffer());
+    kernels.publish();
+}
+
+void LinearPhaseEngine::transformKernel(KernelSpectra& spectra)
+{
+    auto* data = reinterpret_cast<float*>(partitionScratch.data());
+
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        //each partition is zero padded to the FFT size, which is what makes overlap-save work
+        std::fill(partitionScratch.begin(), partitionScratch.end(), std::complex<float>());
+        std::copy(kernel.begin() + p * partitionSize, kernel.begin() + (p + 1) * partitionSize, data);
+
+        partitionFFT->performRealOnlyForwardTransform(data, true);
+        std::copy(partitionScratch.begin(), partitionScratch.begin() + numBins, spectra.begin() + p * numBins);
+    }
+}
+
+void LinearPhaseEngine::process(juce::dsp::AudioBlock<float>& block)
+{
+    processSamples(block);
+}
+
+void LinearPhaseEngine::process(juce::dsp::AudioBlock<double>& block)
+{
+    processSamples(block);
+}
+
+template<typename SampleType>
+void LinearPhaseEngine::processSamples(juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto numChannels = juce::jmin(block.getNumChannels(), channels.size());
+    auto numSamples = block.getNumSamples();
+
+    size_t done = 0;
+    while (done < numSamples)
+    {
+        auto chunk = juce::jmin(numSamples - done, (size_t)(partitionSize - fifoPosition));
+
+        //swap the incoming samples for the output of the previous partition
+        for (size_t ch = 0; ch < numChannels; ++ch)
+        {
+            auto* samples = block.getChannelPointer(ch) + done;
+            auto& state = channels[ch];
+            std::copy(samples, samples + chunk, state.inputWindow.begin() + partitionSize + fifoPosition);
+            std::copy(state.output.begin() + fifoPosition, state.output.begin() + fifoPosition + (int)chunk, samples);
+        }
+
+        fifoPosition += (int)chunk;
+        done += chunk;
+
+        if (fifoPosition == partitionSize)
+        {
+            processPartition();
+            fifoPosition = 0;
+        }
+    }
+}
+
+void LinearPhaseEngine::processPartition()
+{
+    auto* data = reinterpret_cast<float*>(convolutionScratch.data());
+
+    //transform the newest window of every channel into the delay line, then slide the window along
+    for (auto& state : channels)
+    {
+        std::fill(convolutionScratch.begin(), convolutionScratch.end(), std::complex<float>());
+        std::copy(state.inputWindow.begin(), state.inputWindow.end(), data);
+        convolutionFFT->performRealOnlyForwardTransform(data, true);
+        std::copy(convolutionScratch.begin(), convolutionScratch.begin() + numBins,
+                  state.inputSpectra.begin() + delayLineIndex * numBins);
+
+        std::copy(state.inputWindow.begin() + partitionSize, state.inputWindow.end(), state.inputWindow.begin());
+    }
+
+    if (kernels.isNewValueAvailable())
+    {
+        //run this partition through the outgoing kernel before pull() hands its buffer back to the designer
+        for (auto& state : channels)
+            convolve(state, kernels.getReadBuffer(), state.fadeOutput.data());
+
+        kernels.pull();
+
+        //both kernels share the same latency, so a linear crossfade over one partition is seamless
+        for (auto& state : channels)
+        {
+            convolve(state, kernels.getReadBuffer(), state.output.data());
+            for (int n = 0; n < partitionSize; ++n)
+            {
+                auto fade = (n + 0.5f) / partitionSize;
+                state.output[(size_t)n] = state.fadeOutput[(size_t)n] + fade * (state.output[(size_t)n] - state.fadeOutput[(size_t)n]);
+            }
+        }
+    }
+    else
+    {
+        for (auto& state : channels)
+            convolve(state, kernels.getReadBuffer(), state.output.data());
+    }
+
+    delayLineIndex = (delayLineIndex + 1) % numPartitions;
+}
+
+void LinearPhaseEngine::convolve(const ChannelState& state, const KernelSpectra& spectra, float* destination)
+{
+    auto* accumulator = convolutionScratch.data();
+    std::fill(accumulator, accumulator + numBins, std::complex<float>());
+
+    //kernel partition p meets the input from p partitions ago
+    for (int p = 0; p < numPartitions; ++p)
+    {
+        auto slot = (delayLineIndex - p + numPartitions) % numPartitions;
+        auto* input = state.inputSpectra.data() + slot * numBins;
+        auto* partition = spectra.data() + p * numBins;
+
+        for (int k = 0; k < numBins; ++k)
+            accumulator[k] += input[k] * partition[k];
+    }
+
+    //fill in the negative frequencies so every FFT backend sees a complete conjugate symmetric spectrum
+    for (int k = numBins; k < fftSize; ++k)
+        accumulator[k] = std::conj(accumulator[fftSize - k]);
+
+    convolutionFFT->performRealOnlyInverseTransform(reinterpret_cast<float*>(accumulator));
+
+    //overlap-save: the first half is circular wrap around, the second half is this partition's output
+    auto* result = reinterpret_cast<const float*>(accumulator);
+    std::copy(result + partitionSize, result + fftSize, destination);
+}
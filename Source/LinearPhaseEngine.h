@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine: runs the EQ as one long symmetric FIR instead of the
+    IIR cascade, so every band is linear phase.
+
+    The kernel is sampled from the magnitude response of a designed
+    ChainCoefficients set (built on the designer thread), and applied with
+    uniformly partitioned overlap-save FFT convolution on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+#include <vector>
+#include "ChainCoefficients.h"
+#include "LatestValue.h"
+
+class LinearPhaseEngine
+{
+public:
+    //allocates everything, the kernel starts out as a pure delay until the first buildKernel()
+    //the designer thread must not be running while this is called
+    void prepare(double sampleRate, int numChannels);
+    void reset();
+
+    //designer thread: turns a designed set into a new kernel and publishes it
+    void buildKernel(const ChainCoefficients& coefficients);
+
+    //audio thread, allocation free
+    //the convolution itself is float either way, double blocks just convert on the way in and out
+    void process(juce::dsp::AudioBlock<float>& block);
+    void process(juce::dsp::AudioBlock<double>& block);
+
+    //one partition of buffering plus the centre of the symmetric kernel
+    int getLatencySamples() const { return partitionSize + kernelSize / 2; }
+    //the second half of the kernel keeps ringing after the input stops
+    int getTailSamples() const { return kernelSize / 2; }
+
+private:
+    using Spectrum = std::vector<std::complex<float>>;
+
+    //non negative bins of every kernel partition, partition p lives at [p * numBins, (p + 1) * numBins)
+    using KernelSpectra = Spectrum;
+
+    struct ChannelState
+    {
+        std::vector<float> inputWindow;     //previous partition followed by the one being filled
+        std::vector<float> output;          //result of the last partition, played back while the next one fills
+        std::vector<float> fadeOutput;      //same partition through the outgoing kernel while crossfading
+        Spectrum inputSpectra;              //frequency domain delay line, one spectrum per kernel partition
+    };
+
+    template<typename SampleType>
+    void processSamples(juce::dsp::AudioBlock<SampleType>& block);
+    void processPartition();
+    void convolve(const ChannelState& state, const KernelSpectra& spectra, float* destination);
+
+    //transforms the time domain kernel partition by partition
+    void transformKernel(KernelSpectra& spectra);
+
+    static constexpr int partitionSize = 512;
+    static constexpr int fftSize = partitionSize * 2;
+    static constexpr int numBins = partitionSize + 1;
+    //~150ms of kernel, rounded up to a power of two, enough resolution for a 20Hz lowcut
+    static constexpr double kernelLengthSeconds = 0.15;
+
+    double sampleRate = 44100.0;
+    int kernelSize = 0, numPartitions = 0;
+
+    //audio thread
+    std::unique_ptr<juce::dsp::FFT> convolutionFFT;
+    std::vector<ChannelState> channels;
+    Spectrum convolutionScratch;
+    int fifoPosition = 0, delayLineIndex = 0;
+
+    //designer thread
+    std::unique_ptr<juce::dsp::FFT> kernelFFT, partitionFFT;
+    Spectrum kernelScratch, partitionScratch;
+    std::vector<float> window, kernel;
+
+    LatestValue<KernelSpectra> kernels;
+};
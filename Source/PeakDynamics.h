@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    PeakDynamics: turns the peak band into a dynamic band.
+
+    A band-passed copy of the input (same frequency and Q as the peak) drives
+    an envelope follower, and a compressor style gain computer turns how far
+    the envelope sits above the threshold into a change of "Peak Gain".
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "ChainCoefficients.h"
+
+class PeakDynamics
+{
+public:
+    void prepare(double newSampleRate, int numChannels)
+    {
+        sampleRate = newSampleRate;
+        detectorStates.resize((size_t)juce::jmax(1, numChannels));
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& state : detectorStates)
+            state = {};
+        envelope = 0.f;
+    }
+
+    void setParameters(float newThresholdInDecibels, float newRatio, float attackMs, float releaseMs)
+    {
+        thresholdInDecibels = newThresholdInDecibels;
+        ratio = juce::jmax(1.f, newRatio);
+        attackCoefficient = getSmoothingCoefficient(attackMs);
+        releaseCoefficient = getSmoothingCoefficient(releaseMs);
+    }
+
+    //runs the detector over the block (all channels linked, so every channel gets the same gain)
+    //and returns the change in peak gain for it, in decibels, always <= 0
+    //midSide: the block is still L/R, but the peak only filters mid (and any channels past the first two),
+    //so detect on mid = (l + r) / 2 in place of channels 0 and 1, the same way encodeMidSide makes it
+    template<typename SampleType>
+    float process(const juce::dsp::AudioBlock<SampleType>& block, const BiquadCoefficients<double>& detector, bool midSide)
+    {
+        auto numChannels = juce::jmin(block.getNumChannels(), detectorStates.size());
+        auto numSamples = block.getNumSamples();
+        midSide = midSide && numChannels >= 2;
+
+        for (size_t n = 0; n < numSamples; ++n)
+        {
+            auto level = 0.f;
+            for (size_t ch = 0; ch < numChannels; ++ch)
+            {
+                if (midSide && ch == 1)
+                    continue;
+
+                //transposed direct form II, same as the chains
+                auto& state = detectorStates[ch];
+                auto x = static_cast<double>(block.getChannelPointer(ch)[n]);
+                if (midSide && ch == 0)
+                    x = 0.5 * (x + static_cast<double>(block.getChannelPointer(1)[n]));
+                auto y = detector.b0 * x + state.s1;
+                state.s1 = detector.b1 * x - detector.a1 * y + state.s2;
+                state.s2 = detector.b2 * x - detector.a2 * y;
+                level = juce::jmax(level, static_cast<float>(std::abs(y)));
+            }
+
+            auto coefficient = level > envelope ? attackCoefficient : releaseCoefficient;
+            envelope += coefficient * (level - envelope);
+        }
+
+        //one log per block instead of per sample, the envelope is smooth enough for that
+        auto overshoot = juce::Decibels::gainToDecibels(envelope) - thresholdInDecibels;
+        if (overshoot <= 0.f)
+            return 0.f;
+
+        return juce::jmax(overshoot * (1.f / ratio - 1.f), -maxGainChangeInDecibels);
+    }
+
+private:
+    struct DetectorState
+    {
+        double s1 = 0.0, s2 = 0.0;
+    };
+
+    float getSmoothingCoefficient(float timeMs) const
+    {
+        //one pole that gets ~63% of the way there in timeMs
+        return 1.f - std::exp(-1.f / (juce::jmax(0.01f, timeMs) * 0.001f * (float)sampleRate));
+    }
+
+    static constexpr float maxGainChangeInDecibels = 24.f;
+
+    double sampleRate = 44100.0;
+    std::vector<DetectorState> detectorStates;
+    float envelope = 0.f;
+    float thresholdInDecibels = 0.f, ratio = 1.f;
+    float attackCoefficient = 1.f, releaseCoefficient = 1.f;
+};
@@ -208,8 +208,13 @@ juce::String RotarySliderWithLabels::getDisplayString() const
 
 ResponseCurveComponent::ResponseCurveComponent(RomalEQAudioProcessor& p) : audioProcessor(p) 
 //, leftChannelFifo(&audioProcessor.leftChannelFifo)
-, leftPathProducer(audioProcessor.leftChannelFifo),
-rightPathProducer(audioProcessor.rightChannelFifo)
+, analysisJob(audioProcessor.leftChannelFifo, audioProcessor.rightChannelFifo),
+analyzerOverlap(audioProcessor.apvts.getRawParameterValue("Analyzer Overlap")),
+analyzerResolution(audioProcessor.apvts.getRawParameterValue("Analyzer Resolution")),
+analyzerAveraging(audioProcessor.apvts.getRawParameterValue("Analyzer Averaging")),
+analyzerPeakHold(audioProcessor.apvts.getRawParameterValue("Analyzer Peak Hold")),
+analyzerSmoothing(audioProcessor.apvts.getRawParameterValue("Analyzer Smoothing")),
+analyzerMode(audioProcessor.apvts.getRawParameterValue("Analyzer Mode"))
 {
 
     const auto& params = audioProcessor.getParameters();
@@ -222,11 +227,19 @@ rightPathProducer(audioProcessor.rightChannelFifo)
 
 
     updateChain();
+    audioProcessor.setAnalyzerTapEnabled(showFFTAnalysis);
     startTimerHz(60);
 }
 
 ResponseCurveComponent::~ResponseCurveComponent()
 {
+    //wait for a pass that's still running however long it takes, it reads the processor's fifos and
+    //writes into analysisJob, so it must be out of the pool before either goes away
+    //a pass is one window per channel and never blocks, so this doesn't hang
+    auto removed = analyzerPool->removeJob(&analysisJob, true, -1);
+    jassert(removed);
+    juce::ignoreUnused(removed);
+    audioProcessor.setAnalyzerTapEnabled(false);
     const auto& params = audioProcessor.getParameters();
     for (auto param : params) {
         param->removeListener(this);
@@ -240,23 +253,36 @@ void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float new
 
 void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
 {
-    //while there are buffers to pull, if we can pull buffer, send it to FFT data generator
-    juce::AudioBuffer<float> tempIncomingBuffer;
-    while (leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
-    {
-        if (leftChannelFifo->getAudioBuffer(tempIncomingBuffer)) {
-            //shift everything in monoBuffer to make space for incoming data
-            auto size = tempIncomingBuffer.getNumSamples();
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                monoBuffer.getReadPointer(0, size),
-                monoBuffer.getNumSamples() - size);
-            //copy incoming data
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                tempIncomingBuffer.getReadPointer(0, 0),
-                size);
-            //pass it into FFT data generator
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
+    if (!leftChannelFifo->isPrepared())
+        return;
+    leftChannelFifo->skipDiscarded();
+
+    //only whole hops get analysed, so the windows stay hop samples apart whatever the host block size is
+    const auto hopSize = getHopSize();
+    auto numSamples = (leftChannelFifo->getNumSamplesAvailable() / hopSize) * hopSize;
+    if (numSamples > 0)
+    {
+        elapsedSamples += numSamples;
+
+        //fallen behind: only the newest window ever gets drawn, so skip what's older than that instead of transforming it
+        //(monoBuffer holds the biggest window, a multiple of the hop, so the skip is too)
+        const auto windowSize = monoBuffer.getNumSamples();
+        if (numSamples > windowSize)
+        {
+            leftChannelFifo->releaseSamples(numSamples - windowSize);
+            numSamples = windowSize;
         }
+
+        auto incoming = leftChannelFifo->getSamples(numSamples);
+        //shift everything in monoBuffer to make space for incoming data
+        juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
+            monoBuffer.getReadPointer(0, numSamples),
+            windowSize - numSamples);
+        //copy incoming data straight from the fifo's ring
+        incoming.copyTo(monoBuffer.getWritePointer(0, windowSize - numSamples));
+        leftChannelFifo->releaseSamples(numSamples);
+        //one transform per call, of the newest window
+        leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
     }
     //if there are FFT data buffers to pull
     // if we can pull a buffer, generate a path
@@ -267,10 +293,14 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
 
     while (leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
     {
-        std::vector<float> fftData;
         if (leftChannelFFTDataGenerator.getFFTData(fftData))
         {
+            ballistics.process(fftData.data(), fftSize / 2, elapsedSamples / sampleRate, -48.f);
+            elapsedSamples = 0;
+
             pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+            if (ballistics.isPeakHoldEnabled())
+                peakPathProducer.generatePath(ballistics.getPeaks(), fftBounds, fftSize, binWidth, -48.f);
         }
 
     }
@@ -281,17 +311,316 @@ void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
         pathProducer.getPath(leftChannelFFTPath);
 
     }
+    while (peakPathProducer.getNumPathsAvailable())
+    {
+        peakPathProducer.getPath(peakPath);
+    }
+    if (!ballistics.isPeakHoldEnabled())
+        peakPath.clear();
+}
+
+
+StereoPathProducer::StereoPathProducer(SingleChannelSampleFifo& leftFifo, SingleChannelSampleFifo& rightFifo) :
+    fifos{ &leftFifo, &rightFifo }
+{
+    constexpr auto maxFFTSize = AnalyzerTransforms::getMaxFFTSize();
+    windowBuffer.setSize(2, maxFFTSize);
+    windowBuffer.clear();
+
+    packed.resize(maxFFTSize);
+    transformed.resize(maxFFTSize);
+    for (int i = 0; i < numSpectra; ++i)
+    {
+        bins[i].resize(maxFFTSize, 0);
+        spectra[i].resize(maxFFTSize / 2, 0);
+        ballistics[i].prepare(maxFFTSize / 2);
+    }
+
+    crossPower.resize(maxFFTSize / 2, 0);
+    leftPower.resize(maxFFTSize / 2, 0);
+    rightPower.resize(maxFFTSize / 2, 0);
+    correlationBands.reserve(maxCorrelationBands);
+}
+
+void StereoPathProducer::setBallistics(const SpectrumBallistics::Settings& settings)
+{
+    auto withoutPeaks = settings;
+    withoutPeaks.peakDecayDecibelsPerSecond = 0.f;
+    for (auto& b : ballistics)
+        b.setSettings(withoutPeaks);
+}
+
+void StereoPathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+{
+    if (!fifos[0]->isPrepared() || !fifos[1]->isPrepared())
+        return;
+    for (auto* fifo : fifos)
+        fifo->skipDiscarded();
+
+    //skipping (here or in the left/right mode) can leave one channel's reader ahead of the other's
+    //catch the one behind up first, the audio thread may not have written its side of the block yet
+    auto ahead = fifos[0]->getReadPosition() - fifos[1]->getReadPosition();
+    if (ahead != 0)
+    {
+        auto* behind = ahead > 0 ? fifos[1] : fifos[0];
+        auto gap = (int)juce::jmin(std::abs(ahead), (juce::int64)std::numeric_limits<int>::max());
+        auto toSkip = juce::jmin(gap, behind->getNumSamplesAvailable());
+        behind->releaseSamples(toSkip);
+        if (toSkip < gap)
+            return;
+    }
+
+    //both fifos get filled from the same block, just not at the same instant, so go by whichever is behind
+    const auto hopSize = getHopSize();
+    auto available = juce::jmin(fifos[0]->getNumSamplesAvailable(), fifos[1]->getNumSamplesAvailable());
+    auto numSamples = (available / hopSize) * hopSize;
+    if (numSamples == 0)
+        return;
+
+    elapsedSamples += numSamples;
+
+    //same newest-window-only rule as PathProducer, for both channels in step
+    const auto windowSize = windowBuffer.getNumSamples();
+    if (numSamples > windowSize)
+    {
+        for (auto* fifo : fifos)
+            fifo->releaseSamples(numSamples - windowSize);
+        numSamples = windowSize;
+    }
+
+    for (int channel = 0; channel < 2; ++channel)
+    {
+        auto incoming = fifos[channel]->getSamples(numSamples);
+        juce::FloatVectorOperations::copy(windowBuffer.getWritePointer(channel, 0),
+            windowBuffer.getReadPointer(channel, numSamples),
+            windowSize - numSamples);
+        incoming.copyTo(windowBuffer.getWritePointer(channel, windowSize - numSamples));
+        fifos[channel]->releaseSamples(numSamples);
+    }
+
+    analyse(fftBounds, sampleRate, elapsedSamples / sampleRate);
+    elapsedSamples = 0;
+}
+
+void StereoPathProducer::analyse(juce::Rectangle<float> fftBounds, double sampleRate, double elapsedSeconds)
+{
+    const auto fftSize = getFFTSize();
+    const auto numBins = fftSize / 2;
+    const auto binWidth = (float)(sampleRate / (double)fftSize);
+
+    //one window pass for both channels: left in the real part, right in the imaginary part
+    const auto* window = transforms.getWindow(order);
+    const auto* left = windowBuffer.getReadPointer(0, windowBuffer.getNumSamples() - fftSize);
+    const auto* right = windowBuffer.getReadPointer(1, windowBuffer.getNumSamples() - fftSize);
+    for (int i = 0; i < fftSize; ++i)
+        packed[(size_t)i] = { left[i] * window[i], right[i] * window[i] };
+
+    transforms.getFFT(order).perform(packed.data(), transformed.data(), false);
+
+    //a different order puts different frequencies in each bin, start the averages over
+    auto keep = numBins == powerNumBins ? (float)std::exp(-elapsedSeconds / correlationSeconds) : 0.f;
+    powerNumBins = numBins;
+
+    auto* leftBins = bins[LeftSpectrum].data();
+    auto* rightBins = bins[RightSpectrum].data();
+    auto* midBins = bins[MidSpectrum].data();
+    auto* sideBins = bins[SideSpectrum].data();
+    double totalCross = 0.0, totalLeft = 0.0, totalRight = 0.0;
+    for (int k = 0; k < numBins; ++k)
+    {
+        //with z = l + i r: L[k] = (Z[k] + conj(Z[N - k])) / 2, R[k] = (Z[k] - conj(Z[N - k])) / 2i
+        auto z = transformed[(size_t)k];
+        auto mirrored = std::conj(transformed[(size_t)((fftSize - k) & (fftSize - 1))]);
+        auto l = 0.5f * (z + mirrored);
+        auto r = std::complex<float>(0.f, -0.5f) * (z - mirrored);
+        //mid = (L + R) / 2, side = (L - R) / 2, the transform is linear so that holds bin by bin
+        auto m = 0.5f * (l + r);
+        auto sd = 0.5f * (l - r);
+
+        leftBins[2 * k] = l.real();
+        leftBins[2 * k + 1] = l.imag();
+        rightBins[2 * k] = r.real();
+        rightBins[2 * k + 1] = r.imag();
+        midBins[2 * k] = m.real();
+        midBins[2 * k + 1] = m.imag();
+        sideBins[2 * k] = sd.real();
+        sideBins[2 * k + 1] = sd.imag();
+
+        crossPower[(size_t)k] = keep * crossPower[(size_t)k] + (1.f - keep) * (l.real() * r.real() + l.imag() * r.imag());
+        leftPower[(size_t)k] = keep * leftPower[(size_t)k] + (1.f - keep) * std::norm(l);
+        rightPower[(size_t)k] = keep * rightPower[(size_t)k] + (1.f - keep) * std::norm(r);
+
+        //leave dc out of the overall figure
+        if (k > 0)
+        {
+            totalCross += crossPower[(size_t)k];
+            totalLeft += leftPower[(size_t)k];
+            totalRight += rightPower[(size_t)k];
+        }
+    }
+
+    auto correlationOf = [](double cross, double powerA, double powerB)
+    {
+        auto norm = std::sqrt(powerA * powerB);
+        return norm > 1.0e-20 ? (float)juce::jlimit(-1.0, 1.0, cross / norm) : 0.f;
+    };
+    correlation = correlationOf(totalCross, totalLeft, totalRight);
+
+    for (int i = 0; i < numSpectra; ++i)
+    {
+        AnalyzerTransforms::binsToDecibels(bins[i].data(), spectra[i].data(), numBins, -48.f);
+        ballistics[i].process(spectra[i].data(), numBins, elapsedSeconds, -48.f);
+        pathGenerators[i].generatePath(spectra[i], fftBounds, fftSize, binWidth, -48.f);
+        while (pathGenerators[i].getNumPathsAvailable())
+            pathGenerators[i].getPath(paths[i]);
+    }
+
+    //correlation per band, same coordinate conventions as the spectrum paths
+    if (numBins != bandsNumBins || binWidth != bandsBinWidth)
+        buildCorrelationBands(numBins, binWidth);
+
+    auto top = fftBounds.getY();
+    auto bottom = fftBounds.getHeight();
+    auto width = fftBounds.getWidth();
+    correlationPath.clear();
+    for (const auto& band : correlationBands)
+    {
+        double cross = 0.0, powerLeft = 0.0, powerRight = 0.0;
+        for (int k = band.firstBin; k <= band.lastBin; ++k)
+        {
+            cross += crossPower[(size_t)k];
+            powerLeft += leftPower[(size_t)k];
+            powerRight += rightPower[(size_t)k];
+        }
+
+        auto x = band.position * width;
+        auto y = juce::jmap(correlationOf(cross, powerLeft, powerRight), -1.f, 1.f, bottom, top);
+        if (correlationPath.isEmpty())
+            correlationPath.startNewSubPath(x, y);
+        else
+            correlationPath.lineTo(x, y);
+    }
+}
+
+void StereoPathProducer::buildCorrelationBands(int numBins, float binWidth)
+{
+    bandsNumBins = numBins;
+    bandsBinWidth = binWidth;
+    correlationBands.clear();
+
+    //edges a sixth of an octave either side of each centre
+    const auto halfBand = std::exp2(1.f / 6.f);
+    for (int i = 0; i < maxCorrelationBands; ++i)
+    {
+        auto centre = 20.f * std::exp2((float)i / 3.f);
+        if (centre > 20000.f || centre / binWidth > (float)(numBins - 1))
+            break;
+
+        CorrelationBand band;
+        band.position = juce::mapFromLog10(centre, 20.f, 20000.f);
+        band.firstBin = juce::jmax(1, (int)std::ceil(centre / halfBand / binWidth));
+        band.lastBin = juce::jmin(numBins - 1, (int)std::floor(centre * halfBand / binWidth));
+        //bands narrower than a bin (the low end) use the nearest one
+        if (band.lastBin < band.firstBin)
+            band.firstBin = band.lastBin = juce::jlimit(1, numBins - 1, juce::roundToInt(centre / binWidth));
+
+        correlationBands.push_back(band);
+    }
+}
+
+SpectrumAnalysisJob::SpectrumAnalysisJob(SingleChannelSampleFifo& leftFifo, SingleChannelSampleFifo& rightFifo) :
+    juce::ThreadPoolJob("RomalEQ Spectrum Analysis"),
+    leftPathProducer(leftFifo),
+    rightPathProducer(rightFifo),
+    stereoPathProducer(leftFifo, rightFifo)
+{
+}
+
+void SpectrumAnalysisJob::setParameters(juce::Rectangle<float> newFFTBounds, double newSampleRate, PathProducer::AnalyzerOverlap overlap, FFTOrder order,
+                                        const SpectrumBallistics::Settings& ballistics, AnalyzerMode newMode)
+{
+    mode = newMode;
+    fftBounds = newFFTBounds;
+    sampleRate = newSampleRate;
+    leftPathProducer.setOverlap(overlap);
+    rightPathProducer.setOverlap(overlap);
+    leftPathProducer.setOrder(order);
+    rightPathProducer.setOrder(order);
+    leftPathProducer.setBallistics(ballistics);
+    rightPathProducer.setBallistics(ballistics);
+    stereoPathProducer.setOverlap(overlap);
+    stereoPathProducer.setOrder(order);
+    stereoPathProducer.setBallistics(ballistics);
+}
+
+juce::ThreadPoolJob::JobStatus SpectrumAnalysisJob::runJob()
+{
+    auto& latest = paths.getWriteBuffer();
+    latest.isStereo = mode == StereoMode;
+
+    if (latest.isStereo)
+    {
+        stereoPathProducer.process(fftBounds, sampleRate);
+
+        latest.left = stereoPathProducer.getPath(StereoPathProducer::LeftSpectrum);
+        latest.right = stereoPathProducer.getPath(StereoPathProducer::RightSpectrum);
+        latest.mid = stereoPathProducer.getPath(StereoPathProducer::MidSpectrum);
+        latest.side = stereoPathProducer.getPath(StereoPathProducer::SideSpectrum);
+        latest.correlationCurve = stereoPathProducer.getCorrelationPath();
+        latest.correlation = stereoPathProducer.getCorrelation();
+        latest.leftPeaks.clear();
+        latest.rightPeaks.clear();
+    }
+    else
+    {
+        leftPathProducer.process(fftBounds, sampleRate);
+        rightPathProducer.process(fftBounds, sampleRate);
+
+        latest.left = leftPathProducer.getPath();
+        latest.right = rightPathProducer.getPath();
+        latest.leftPeaks = leftPathProducer.getPeakPath();
+        latest.rightPeaks = rightPathProducer.getPeakPath();
+        latest.mid.clear();
+        latest.side.clear();
+        latest.correlationCurve.clear();
+    }
+    paths.publish();
+
+    return jobHasFinished;
 }
 
 
+SpectrumBallistics::Settings ResponseCurveComponent::getBallisticsSettings() const
+{
+    //same order as the parameter choices
+    static constexpr float averagingSeconds[] = { 0.f, 0.1f, 0.3f, 1.f };
+    static constexpr float peakDecays[] = { 0.f, 6.f, 12.f, 24.f };
+    static constexpr float smoothingOctaves[] = { 0.f, 1.f / 12.f, 1.f / 6.f, 1.f / 3.f };
+
+    SpectrumBallistics::Settings settings;
+    settings.averagingSeconds = averagingSeconds[static_cast<int>(analyzerAveraging->load())];
+    settings.peakDecayDecibelsPerSecond = peakDecays[static_cast<int>(analyzerPeakHold->load())];
+    settings.smoothingOctaves = smoothingOctaves[static_cast<int>(analyzerSmoothing->load())];
+    return settings;
+}
+
 void ResponseCurveComponent::timerCallback() {
     
     if (showFFTAnalysis)
     {
-        auto fftBounds = getAnalysisArea().toFloat();
+        //the job's inputs are only touched while it's out of the pool, so it never sees them change mid pass
+        //if the last pass hasn't finished yet, just draw what we have and try again next tick
+        //no sample rate before prepareToPlay, so no bin width to lay the spectrum out with either
         auto sampleRate = audioProcessor.getSampleRate();
-        leftPathProducer.process(fftBounds, sampleRate);
-        rightPathProducer.process(fftBounds, sampleRate);
+        if (sampleRate > 0.0 && !analyzerPool->contains(&analysisJob))
+        {
+            auto overlap = static_cast<PathProducer::AnalyzerOverlap>(static_cast<int>(analyzerOverlap->load()));
+            auto order = static_cast<FFTOrder>(order2048 + static_cast<int>(analyzerResolution->load()));
+            auto mode = static_cast<SpectrumAnalysisJob::AnalyzerMode>(static_cast<int>(analyzerMode->load()));
+            analysisJob.setParameters(getAnalysisArea().toFloat(), sampleRate, overlap, order, getBallisticsSettings(), mode);
+            analyzerPool->addJob(&analysisJob, false);
+        }
+        analysisJob.pullLatest();
     }
 
     if (parametersChanged.compareAndSetBool(false, true))
@@ -311,25 +640,12 @@ void ResponseCurveComponent::timerCallback() {
 void ResponseCurveComponent::updateChain() {
 
 
- //update the monochain in the editor
-     // get chain settings and coefficients from audioProcessor and use them to update editor chain
+     // get chain settings from audioProcessor and design the same coefficients the processor runs
     auto chainSettings = getChainSettings(audioProcessor.apvts);
 
-
-    monoChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    monoChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    monoChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    // update monochain
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-
-
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-
-    updateCutFilter(monoChain.get<ChainPositions::LowCut >(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut >(), highCutCoefficients, chainSettings.highCutSlope);
+    //same design path the processor uses, just done right here on the message thread
+    //the curve is drawn straight from these, so it covers however many bands are switched on
+    designChainCoefficients(chainSettings, audioProcessor.getSampleRate(), ChainBands::AllBands, chainCoefficients);
 }
 
 void ResponseCurveComponent::paint(juce::Graphics& g)
@@ -350,44 +666,15 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
      auto responseArea = getAnalysisArea();
     //auto responseArea = bounds.removeFromTop(bounds.getHeight() * 0.33);
     auto w = responseArea.getWidth();
-    auto& lowcut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highcut = monoChain.get<ChainPositions::HighCut>();
     auto sampleRate = audioProcessor.getSampleRate();
     std::vector<double> mags;
     mags.resize(w);
 
     //mapping pixels 
     for (int i = 0; i < w; ++i) {
-        double mag = 1.f;
         auto freq = mapToLog10(double(i) / double(w), 20.0, 20000.0);
-        if (!monoChain.isBypassed<ChainPositions::Peak>())
-            mag *= peak.coefficients->getMagnitudeForFrequency(freq, sampleRate);
-
-
-
-        if (!monoChain.isBypassed<ChainPositions::LowCut>())
-        {
-            if (!lowcut.isBypassed<0>())
-                mag *= lowcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<1>())
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<2>())
-                mag *= lowcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!lowcut.isBypassed<3>())
-                mag *= lowcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
-        if (!monoChain.isBypassed<ChainPositions::HighCut>())
-        {
-            if (!highcut.isBypassed<0>())
-                mag *= highcut.get<0>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<1>())
-                mag *= lowcut.get<1>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<2>())
-                mag *= highcut.get<2>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-            if (!highcut.isBypassed<3>())
-                mag *= highcut.get<3>().coefficients->getMagnitudeForFrequency(freq, sampleRate);
-        }
+        //takes care of bypassed / off bands and the oversampled design rate
+        double mag = getChainMagnitudeForFrequency(chainCoefficients, freq, sampleRate);
 
         //TODO fix heights of curve so I don't have to have this +1 hack in here to get curve on 0 db line
         mags[i] = Decibels::gainToDecibels(mag) + 1;
@@ -409,17 +696,39 @@ void ResponseCurveComponent::paint(juce::Graphics& g)
     //transform path to be at bottom and not at weird origin
     if (showFFTAnalysis) 
     {
-        auto leftChannelFFTPath = leftPathProducer.getPath();
+        const auto& analyzerPaths = analysisJob.getLatest();
+        //held peaks underneath, fainter than the spectrum itself (both empty while peak hold is off)
+        auto toResponseArea = AffineTransform().translation(responseArea.getX(), responseArea.getY());
+        g.setColour(Colours::skyblue.withAlpha(0.4f));
+        g.strokePath(analyzerPaths.leftPeaks, PathStrokeType(1.f), toResponseArea);
+        g.setColour(Colours::lightyellow.withAlpha(0.4f));
+        g.strokePath(analyzerPaths.rightPeaks, PathStrokeType(1.f), toResponseArea);
+
+        auto leftChannelFFTPath = analyzerPaths.left;
         leftChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
 
         g.setColour(Colours::skyblue);
         g.strokePath(leftChannelFFTPath, PathStrokeType(1.f));
 
-        auto rightChannelFFTPath = rightPathProducer.getPath();
+        auto rightChannelFFTPath = analyzerPaths.right;
         rightChannelFFTPath.applyTransform(AffineTransform().translation(responseArea.getX(), responseArea.getY()));
 
         g.setColour(Colours::lightyellow);
         g.strokePath(rightChannelFFTPath, PathStrokeType(1.f));
+
+        if (analyzerPaths.isStereo)
+        {
+            g.setColour(Colours::lightgreen);
+            g.strokePath(analyzerPaths.mid, PathStrokeType(1.f), toResponseArea);
+            g.setColour(Colours::orchid);
+            g.strokePath(analyzerPaths.side, PathStrokeType(1.f), toResponseArea);
+
+            //per band correlation, +1 at the top and -1 at the bottom, with the overall figure in the corner
+            g.setColour(Colours::white.withAlpha(0.5f));
+            g.strokePath(analyzerPaths.correlationCurve, PathStrokeType(1.f), toResponseArea);
+            auto readoutArea = responseArea.withTrimmedTop(2).withHeight(14).withTrimmedRight(4);
+            g.drawText("Corr " + String(analyzerPaths.correlation, 2), readoutArea, Justification::centredRight);
+        }
     }
     //end draw spectrum
 
@@ -637,6 +946,10 @@ RomalEQAudioProcessorEditor::RomalEQAudioProcessorEditor(RomalEQAudioProcessor&
     highcutBypassButton.setLookAndFeel(&lnf);
     analyzerEnabledButton.setLookAndFeel(&lnf);
 
+    //same choices as the parameter, in the same order
+    analyzerResolutionBox.addItemList(audioProcessor.apvts.getParameter("Analyzer Resolution")->getAllValueStrings(), 1);
+    analyzerResolutionAttachment = std::make_unique<APVTS::ComboBoxAttachment>(audioProcessor.apvts, "Analyzer Resolution", analyzerResolutionBox);
+
     //save state of AudioProcessorEditor because everything is asynchronous and may change while this is running?
     auto safePtr = juce::Component::SafePointer<RomalEQAudioProcessorEditor>(this);
     //TODO what is going on here syntax wise
@@ -719,6 +1032,7 @@ void RomalEQAudioProcessorEditor::resized()
     analyzerEnabledArea.setX(5);
     analyzerEnabledArea.removeFromTop(2);
     analyzerEnabledButton.setBounds(analyzerEnabledArea);
+    analyzerResolutionBox.setBounds(analyzerEnabledArea.withX(analyzerEnabledArea.getRight() + 5));
     bounds.removeFromTop(5);
 
 
@@ -765,7 +1079,8 @@ std::vector<juce::Component*> RomalEQAudioProcessorEditor::getComps() {
         &lowcutBypassButton, 
         &peakBypassButton, 
         &highcutBypassButton, 
-        &analyzerEnabledButton
+        &analyzerEnabledButton,
+        &analyzerResolutionBox
     };
 
 }
\ No newline at end of file
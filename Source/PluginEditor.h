@@ -10,6 +10,9 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumBallistics.h"
+#include <complex>
+#include <cstring>
 
 //==============================================================================
 /**
@@ -23,80 +26,115 @@ enum FFTOrder
     order8192 = 13
 };
 
-template<typename BlockType>
-struct FFTDataGenerator
+//the FFT and window for every order, built up front so changing order is just picking another one
+//memory, all three orders together (14336 points): the windows are 56 KB, the FFT tables depend on the engine,
+//JUCE's fallback one keeps a forward and an inverse twiddle table of N complex floats each, so 224 KB
+struct AnalyzerTransforms
 {
-    /**
-     produces the FFT data from an audio buffer.
-     */
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    AnalyzerTransforms()
     {
-        const auto fftSize = getFFTSize();
-
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
-
-        // first apply a windowing function to our data
-        window->multiplyWithWindowingTable(fftData.data(), fftSize);       // [1]
+        for (int i = 0; i < numOrders; ++i)
+        {
+            auto fftSize = 1 << (order2048 + i);
+            forwardFFTs[i] = std::make_unique<juce::dsp::FFT>(order2048 + i);
+            windows[i].resize(fftSize);
+            juce::dsp::WindowingFunction<float>::fillWindowingTables(windows[i].data(), fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        }
+    }
 
-        // then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform(fftData.data());  // [2]
+    const juce::dsp::FFT& getFFT(FFTOrder order) const { return *forwardFFTs[order - order2048]; }
+    const float* getWindow(FFTOrder order) const { return windows[order - order2048].data(); }
+    static constexpr int getMaxFFTSize() { return 1 << order8192; }
 
-        int numBins = (int)fftSize / 2;
+    //magnitude, normalise by numBins, drop inf/nan and convert to decibels, all in one pass
+    //branchless, with the float bits read through memcpy, so compilers can run it on SIMD lanes
+    //(gcc 12 -O3 vectorises it, 4 lanes with SSE2, 8 with AVX2; keep it free of calls and early outs)
+    static void binsToDecibels(const float* bins, float* decibels, int numBins, float negativeInfinity)
+    {
+        //20 log10(|X| / numBins) = 10 log10(re^2 + im^2) - 20 log10(numBins), and 10 log10(x) = 10 log10(2) * log2(x)
+        const auto offset = -20.f * std::log10((float)numBins);
+        constexpr auto tenLog10Of2 = 3.01029996f;
 
-        //normalize the fft values.
         for (int i = 0; i < numBins; ++i)
         {
-            auto v = fftData[i];
-            //            fftData[i] /= (float) numBins;
-            if (!std::isinf(v) && !std::isnan(v))
-            {
-                v /= float(numBins);
-            }
-            else
-            {
-                v = 0.f;
-            }
-            fftData[i] = v;
+            auto re = bins[2 * i];
+            auto im = bins[2 * i + 1];
+            auto power = re * re + im * im;
+
+            //log2 = exponent + log2(mantissa), the mantissa part from a cubic around 1.5 (within 0.004dB)
+            //zero and denormals come out near -127, far below negativeInfinity
+            juce::uint32 bits;
+            std::memcpy(&bits, &power, sizeof(bits));
+            auto exponent = (int)(bits >> 23);
+            auto mantissaBits = (bits & 0x007fffffu) | 0x3f800000u;
+            float m;
+            std::memcpy(&m, &mantissaBits, sizeof(m));
+            m -= 1.5f;
+            auto log2Power = (float)(exponent - 127) + (0.585378736f + (0.961167861f + (-0.336888795f + 0.153918478f * m) * m) * m);
+
+            auto db = tenLog10Of2 * log2Power + offset;
+            db = db > negativeInfinity ? db : negativeInfinity;
+            //an all ones exponent is inf or nan, those bins read as silence
+            decibels[i] = exponent < 255 ? db : negativeInfinity;
         }
+    }
 
-        //convert them to decibels
-        for (int i = 0; i < numBins; ++i)
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
+private:
+    static constexpr int numOrders = order8192 - order2048 + 1;
+    std::array<std::unique_ptr<juce::dsp::FFT>, numOrders> forwardFFTs;
+    std::array<std::vector<float>, numOrders> windows;
+};
 
-        fftDataFifo.push(fftData);
+//the buffers for every order get built up front too, so changing order never allocates
+//memory on top of its AnalyzerTransforms: fftData 64 KB, spectrum 16 KB and the fifo's 30 spectra 480 KB,
+//so with the transforms about 840 KB per generator, one per PathProducer
+template<typename BlockType>
+struct FFTDataGenerator
+{
+    FFTDataGenerator()
+    {
+        //sized for the biggest order, smaller ones only use the front
+        //the transform needs 2N, what gets handed on is one decibel value per bin
+        fftData.resize(getMaxFFTSize() * 2, 0);
+        spectrum.resize(getMaxFFTSize() / 2, 0);
+        fftDataFifo.prepare(spectrum.size());
     }
 
-    void changeOrder(FFTOrder newOrder)
+    /**
+     produces the FFT data from an audio buffer, using its newest getFFTSize() samples.
+     */
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
     {
-        //when you change order, recreate the window, forwardFFT, fifo, fftData
-        //also reset the fifoIndex
-        //things that need recreating should be created on the heap via std::make_unique<>
+        const auto fftSize = getFFTSize();
 
-        order = newOrder;
-        auto fftSize = getFFTSize();
+        //window on the way in, the real-only transform never reads past the first fftSize values so nothing needs zeroing
+        auto* readIndex = audioData.getReadPointer(0, audioData.getNumSamples() - fftSize);
+        juce::FloatVectorOperations::multiply(fftData.data(), readIndex, transforms.getWindow(order), fftSize);
+
+        //leaves (re, im) pairs for bins 0 to fftSize / 2
+        transforms.getFFT(order).performRealOnlyForwardTransform(fftData.data(), true);
 
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        AnalyzerTransforms::binsToDecibels(fftData.data(), spectrum.data(), fftSize / 2, negativeInfinity);
 
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
+        fftDataFifo.push(spectrum);
+    }
 
-        fftDataFifo.prepare(fftData.size());
+    //doesn't allocate, everything got built in the constructor
+    //blocks still in the fifo were made with the old order, pull them before switching
+    void changeOrder(FFTOrder newOrder)
+    {
+        order = newOrder;
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; }
+    static constexpr int getMaxFFTSize() { return AnalyzerTransforms::getMaxFFTSize(); }
     int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
     //==============================================================================
     bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
 private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    FFTOrder order{ order2048 };
+    BlockType fftData, spectrum;
+    AnalyzerTransforms transforms;
 
     Fifo<BlockType> fftDataFifo;
 };
@@ -105,7 +143,7 @@ template<typename PathType>
 struct AnalyzerPathGenerator
 {
     /*
-     converts 'renderData[]' into a juce::Path
+     converts 'renderData[]' into a juce::Path, one point per pixel column
      */
     void generatePath(const std::vector<float>& renderData,
         juce::Rectangle<float> fftBounds,
@@ -115,12 +153,16 @@ struct AnalyzerPathGenerator
     {
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
+        auto width = (int)fftBounds.getWidth();
+
+        jassert(binWidth > 0.f);
 
-        int numBins = (int)fftSize / 2;
+        //only moves when the editor gets resized, the fft order changes or the sample rate does
+        if (width != tableWidth || fftSize != tableFFTSize || binWidth != tableBinWidth)
+            buildColumnTable(width, fftSize, binWidth);
 
         PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        p.preallocateSpace(3 * width);
 
         auto map = [bottom, top, negativeInfinity](float v)
         {
@@ -129,29 +171,28 @@ struct AnalyzerPathGenerator
                 float(bottom + 10), top);
         };
 
-        auto y = map(renderData[0]);
-
-        //        jassert( !std::isnan(y) && !std::isinf(y) );
-        if (std::isnan(y) || std::isinf(y))
-            y = bottom;
-
-        p.startNewSubPath(0, y);
-
-        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
-
-        for (int binNum = 1; binNum < numBins; binNum += pathResolution)
+        for (int x = 0; x < (int)columns.size(); ++x)
         {
-            y = map(renderData[binNum]);
-
-            //            jassert( !std::isnan(y) && !std::isinf(y) );
-
-            if (!std::isnan(y) && !std::isinf(y))
+            const auto& column = columns[(size_t)x];
+            float db;
+            if (column.lastBin >= column.firstBin)
             {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
+                //several bins on this pixel: keep the loudest, so peaks don't get averaged away
+                db = renderData[(size_t)column.firstBin];
+                for (int bin = column.firstBin + 1; bin <= column.lastBin; ++bin)
+                    db = juce::jmax(db, renderData[(size_t)bin]);
             }
+            else
+            {
+                //no bin on this pixel (the low end): interpolate between the two either side
+                auto below = renderData[(size_t)column.firstBin - 1];
+                db = below + column.fraction * (renderData[(size_t)column.firstBin] - below);
+            }
+
+            if (x == 0)
+                p.startNewSubPath(0, map(db));
+            else
+                p.lineTo((float)x, map(db));
         }
 
         pathFifo.push(p);
@@ -167,6 +208,49 @@ struct AnalyzerPathGenerator
         return pathFifo.pull(path);
     }
 private:
+    //the bins that land on one pixel column, firstBin..lastBin
+    //lastBin < firstBin means none do, the column then sits fraction of the way from firstBin - 1 to firstBin
+    struct ColumnBins
+    {
+        int firstBin = 1, lastBin = 0;
+        float fraction = 0.f;
+    };
+
+    void buildColumnTable(int width, int fftSize, float binWidth)
+    {
+        tableWidth = width;
+        tableFFTSize = fftSize;
+        tableBinWidth = binWidth;
+        columns.clear();
+
+        //highest bin is nyquist - binWidth, columns above it (low sample rates) are left off the path
+        const auto lastBin = fftSize / 2 - 1;
+        for (int x = 0; x < width; ++x)
+        {
+            //the column covers [x, x + 1) on the log frequency axis
+            auto lowPosition = juce::mapToLog10((float)x / (float)width, 20.f, 20000.f) / binWidth;
+            auto highPosition = juce::mapToLog10((float)(x + 1) / (float)width, 20.f, 20000.f) / binWidth;
+            if (lowPosition > (float)lastBin)
+                break;
+
+            ColumnBins column;
+            column.firstBin = juce::jmax(1, (int)std::ceil(lowPosition));
+            column.lastBin = juce::jmin(lastBin, (int)std::ceil(highPosition) - 1);
+            if (column.lastBin < column.firstBin)
+            {
+                //interpolate at the column's middle
+                auto position = 0.5f * (lowPosition + highPosition);
+                column.firstBin = juce::jlimit(1, lastBin, (int)position + 1);
+                column.fraction = juce::jlimit(0.f, 1.f, position - (float)(column.firstBin - 1));
+            }
+            columns.push_back(column);
+        }
+    }
+
+    std::vector<ColumnBins> columns;
+    int tableWidth = -1, tableFFTSize = 0;
+    float tableBinWidth = 0.f;
+
     Fifo<PathType> pathFifo;
 };
 
@@ -174,22 +258,160 @@ private:
 
 struct PathProducer {
     //convert audio samples into FFT data
-    PathProducer(SingleChannelSampleFifo<RomalEQAudioProcessor::BlockType>& scsf) :
+    PathProducer(SingleChannelSampleFifo& scsf) :
     leftChannelFifo(&scsf) {
-        leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-        monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
-
+        //room for the biggest window, smaller orders analyse the newest part of it
+        //so switching order never has to wait for the buffer to fill up again
+        monoBuffer.setSize(1, leftChannelFFTDataGenerator.getMaxFFTSize());
+        monoBuffer.clear();
+        fftData.resize(leftChannelFFTDataGenerator.getMaxFFTSize() / 2, 0);
+        ballistics.prepare(leftChannelFFTDataGenerator.getMaxFFTSize() / 2);
     }
     void process(juce::Rectangle<float> fftBounds, double sampleRate);
     juce::Path getPath() { return leftChannelFFTPath; }
+    //empty while peak hold is off
+    juce::Path getPeakPath() { return peakPath; }
+
+    //how far apart consecutive analysis windows start, as a share of the fft size
+    enum AnalyzerOverlap {
+        Overlap50,
+        Overlap75
+    };
+    void setOverlap(AnalyzerOverlap newOverlap) { overlap = newOverlap; }
+    //only between calls to process(), it doesn't allocate
+    void setOrder(FFTOrder newOrder) { leftChannelFFTDataGenerator.changeOrder(newOrder); }
+    void setBallistics(const SpectrumBallistics::Settings& settings) { ballistics.setSettings(settings); }
+    int getHopSize() const { return leftChannelFFTDataGenerator.getFFTSize() >> (overlap == Overlap75 ? 2 : 1); }
 private:
-    SingleChannelSampleFifo<RomalEQAudioProcessor::BlockType>* leftChannelFifo;
+    SingleChannelSampleFifo* leftChannelFifo;
     juce::AudioBuffer<float> monoBuffer;
     FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
-    AnalyzerPathGenerator<juce::Path> pathProducer;
-    juce::Path leftChannelFFTPath;
+    //what FFT data blocks get pulled into, kept at the biggest size so pulling doesn't allocate
+    std::vector<float> fftData;
+    //averaging, peak hold and smoothing, applied to fftData in place
+    SpectrumBallistics ballistics;
+    //samples drained from the fifo (skipped ones too) since the last frame, that's how much time it stands for
+    int elapsedSamples = 0;
+    AnalyzerPathGenerator<juce::Path> pathProducer, peakPathProducer;
+    juce::Path leftChannelFFTPath, peakPath;
+    AnalyzerOverlap overlap{ Overlap50 };
+};
+
+//stereo analysis: L, R, mid and side spectra plus phase correlation, from one complex FFT per frame
+//L and R go in as the real and imaginary parts and get pulled apart again through conjugate symmetry,
+//mid and side are sums and differences of those bins, so it's one transform and one window pass instead of four
+struct StereoPathProducer
+{
+    enum Spectrum {
+        LeftSpectrum,
+        RightSpectrum,
+        MidSpectrum,
+        SideSpectrum,
+        numSpectra
+    };
+
+    StereoPathProducer(SingleChannelSampleFifo& leftFifo, SingleChannelSampleFifo& rightFifo);
+    void process(juce::Rectangle<float> fftBounds, double sampleRate);
+
+    //same hop and order rules as PathProducer, only between calls to process()
+    void setOverlap(PathProducer::AnalyzerOverlap newOverlap) { overlap = newOverlap; }
+    void setOrder(FFTOrder newOrder) { order = newOrder; }
+    //averaging and smoothing apply to all four spectra, peak hold isn't drawn in this mode
+    void setBallistics(const SpectrumBallistics::Settings& settings);
+    int getFFTSize() const { return 1 << order; }
+    int getHopSize() const { return getFFTSize() >> (overlap == PathProducer::Overlap75 ? 2 : 1); }
+
+    juce::Path getPath(Spectrum spectrum) { return paths[spectrum]; }
+    //-1 (out of phase) to +1 (mono), 0 while there's nothing to compare
+    float getCorrelation() const { return correlation; }
+    //the same per third octave band, +1 at the top of the bounds and -1 at the bottom
+    juce::Path getCorrelationPath() { return correlationPath; }
+private:
+    void analyse(juce::Rectangle<float> fftBounds, double sampleRate, double elapsedSeconds);
+    void buildCorrelationBands(int numBins, float binWidth);
+
+    std::array<SingleChannelSampleFifo*, 2> fifos;
+    //both channels, newest samples at the end, sized for the biggest window like PathProducer's
+    juce::AudioBuffer<float> windowBuffer;
+    AnalyzerTransforms transforms;
+    FFTOrder order{ order2048 };
+    PathProducer::AnalyzerOverlap overlap{ PathProducer::Overlap50 };
+    int elapsedSamples = 0;
+
+    std::vector<std::complex<float>> packed, transformed;
+    //(re, im) pairs per spectrum, then the decibels they turn into
+    std::array<std::vector<float>, numSpectra> bins, spectra;
+    std::array<SpectrumBallistics, numSpectra> ballistics;
+    std::array<AnalyzerPathGenerator<juce::Path>, numSpectra> pathGenerators;
+    std::array<juce::Path, numSpectra> paths;
+
+    //per bin cross and auto power, averaged over correlationSeconds
+    //correlation is the cross power over the geometric mean of the two auto powers
+    std::vector<float> crossPower, leftPower, rightPower;
+    int powerNumBins = 0;
+    static constexpr float correlationSeconds = 0.3f;
+    float correlation = 0.f;
+
+    //third octave bands 20Hz to 20kHz, rebuilt only when the order or sample rate changes
+    struct CorrelationBand
+    {
+        int firstBin = 1, lastBin = 1;
+        //band centre on the log frequency axis, 0 to 1
+        float position = 0.f;
+    };
+    static constexpr int maxCorrelationBands = 32;
+    std::vector<CorrelationBand> correlationBands;
+    int bandsNumBins = 0;
+    float bandsBinWidth = 0.f;
+    juce::Path correlationPath;
+};
+
+//the spectra, as handed from the analysis job to the editor
+struct AnalyzerPaths
+{
+    juce::Path left, right;
+    juce::Path leftPeaks, rightPeaks;
+    //stereo mode only
+    bool isStereo = false;
+    juce::Path mid, side, correlationCurve;
+    float correlation = 0.f;
+};
+
+//runs both channels' PathProducers off the message thread, one pass each time it gets queued
+//finished paths go out through a LatestValue mailbox, the editor only picks them up and strokes them
+struct SpectrumAnalysisJob : juce::ThreadPoolJob
+{
+    SpectrumAnalysisJob(SingleChannelSampleFifo& leftFifo, SingleChannelSampleFifo& rightFifo);
+
+    enum AnalyzerMode {
+        LeftRightMode,  //a PathProducer per channel
+        StereoMode      //StereoPathProducer: L, R, mid, side and correlation
+    };
 
+    //message thread, only while the job isn't in the pool (queued or running)
+    void setParameters(juce::Rectangle<float> newFFTBounds, double newSampleRate, PathProducer::AnalyzerOverlap overlap, FFTOrder order,
+                       const SpectrumBallistics::Settings& ballistics, AnalyzerMode newMode);
 
+    JobStatus runJob() override;
+
+    //message thread: true if newer paths got published since the last call
+    bool pullLatest() { return paths.pull(); }
+    const AnalyzerPaths& getLatest() const { return paths.getReadBuffer(); }
+private:
+    PathProducer leftPathProducer, rightPathProducer;
+    //reads the same fifos, only one of the two runs in a pass
+    StereoPathProducer stereoPathProducer;
+    AnalyzerMode mode{ LeftRightMode };
+    juce::Rectangle<float> fftBounds;
+    double sampleRate = 44100.0;
+    LatestValue<AnalyzerPaths> paths;
+};
+
+//one pool for every open editor, across all instances of the plugin in the process
+struct AnalyzerThreadPool : juce::ThreadPool
+{
+    //a pass is a couple of ffts and paths, so a few threads keep up with lots of editors without crowding the host
+    AnalyzerThreadPool() : juce::ThreadPool(juce::jlimit(1, 4, juce::SystemStats::getNumCpus() / 2)) {}
 };
 
 
@@ -216,13 +438,16 @@ struct ResponseCurveComponent : juce::Component,
 
     void toggleAnalysisEnablement(bool enabled) {
         showFFTAnalysis = enabled;
+        //no point feeding the fifos when nothing reads them
+        audioProcessor.setAnalyzerTapEnabled(enabled);
     }
 
     private:
         RomalEQAudioProcessor& audioProcessor;
         juce::Atomic<bool> parametersChanged{ false };
         
-        MonoChain monoChain;
+        //designed from the apvts on the message thread, the response curve is drawn from this
+        ChainCoefficients chainCoefficients;
 
         void updateChain();
 
@@ -235,8 +460,17 @@ struct ResponseCurveComponent : juce::Component,
         juce::Rectangle<int> getAnalysisArea();
 
 
-        //convert audio samples into FFT data
-        PathProducer leftPathProducer, rightPathProducer;
+        //convert audio samples into FFT data, on the shared pool
+        //this only queues the work and draws what comes back
+        juce::SharedResourcePointer<AnalyzerThreadPool> analyzerPool;
+        SpectrumAnalysisJob analysisJob;
+        std::atomic<float>* analyzerOverlap = nullptr;
+        std::atomic<float>* analyzerResolution = nullptr;
+        std::atomic<float>* analyzerAveraging = nullptr;
+        std::atomic<float>* analyzerPeakHold = nullptr;
+        std::atomic<float>* analyzerSmoothing = nullptr;
+        std::atomic<float>* analyzerMode = nullptr;
+        SpectrumBallistics::Settings getBallisticsSettings() const;
 
         bool showFFTAnalysis = true;
 };
@@ -329,6 +563,7 @@ private:
 
     PowerButton lowcutBypassButton, peakBypassButton, highcutBypassButton;
     AnalyzerButton analyzerEnabledButton;
+    juce::ComboBox analyzerResolutionBox;
 
 
 
@@ -345,6 +580,8 @@ private:
         lowCutFreqSliderAttachment, highCutFreqSliderAttachment, lowCutSlopeSliderAttachment, highCutSlopeSliderAttachment;
     using ButtonAttachment = APVTS::ButtonAttachment;
     ButtonAttachment lowcutButtonAttachment, highcutButtonAttachment, peakButtonAttachment, analyzerButtonAttachment;
+    //made in the constructor body, the box needs its items before it gets attached
+    std::unique_ptr<APVTS::ComboBoxAttachment> analyzerResolutionAttachment;
 
     CustomLookAndFeel lnf;
 
@@ -22,10 +22,35 @@ RomalEQAudioProcessor::RomalEQAudioProcessor()
                        )
 #endif
 {
+    //ui changes wake the designer straight away, everything else gets picked up by its poll
+    chainSettingsTracker.onBandChanged = [this]()
+    {
+        if (juce::MessageManager::existsAndIsCurrentThread())
+            coefficientDesigner.triggerRedesign();
+    };
+
+    for (auto& mapping : ccMappings)
+    {
+        mapping.controllerNumber = apvts.getRawParameterValue("CC " + mapping.parameterID);
+        mapping.parameter = apvts.getParameter(mapping.parameterID);
+        apvts.addParameterListener("CC " + mapping.parameterID, this);
+    }
+
+    //kernels are only worth building while linear phase is selected, switching to it redesigns every band anyway
+    coefficientDesigner.onSetDesigned = [this](const ChainCoefficients& chainCoefficients)
+    {
+        if (phaseModeParameter->load() > 0.5f)
+            linearPhaseEngine.buildKernel(chainCoefficients);
+    };
+
+    updateParameterTimer();
 }
 
 RomalEQAudioProcessor::~RomalEQAudioProcessor()
 {
+    for (auto& mapping : ccMappings)
+        apvts.removeParameterListener("CC " + mapping.parameterID, this);
+    stopTimer();
 }
 
 //==============================================================================
@@ -63,7 +88,7 @@ bool RomalEQAudioProcessor::isMidiEffect() const
 
 double RomalEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int RomalEQAudioProcessor::getNumPrograms()
@@ -96,15 +121,58 @@ void RomalEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBloc
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
 
+    //the designer thread builds linear phase kernels into buffers we are about to reallocate, so park it first
+    coefficientDesigner.release();
+
     //prepare process spec object and pass it to chain, which then passes into each link in the chain
     juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
+    //the chains see oversampled blocks, so leave room for the biggest factor
+    spec.maximumBlockSize = samplesPerBlock << maxOversamplingOrder;
     spec.numChannels = 1;
     spec.sampleRate = sampleRate;
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+
+    auto numChannels = juce::jmax(1, getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    //both precisions are ready to go, the host (or "Filter Precision") can switch between them at any time
+    floatChains.prepare(spec, numChannels, samplesPerBlock, maxOversamplingOrder);
+    doubleChains.prepare(spec, numChannels, samplesPerBlock, maxOversamplingOrder);
+    //no valid order yet, so the updateOversampling() below always picks an oversampler and reports the latency
+    oversamplingOrder = -1;
+
+    linearPhaseEngine.prepare(sampleRate, numChannels);
+    peakDynamics.prepare(sampleRate, numChannels);
+    dynamicWasActive = false;
+    linearPhaseActive = phaseModeParameter->load() > 0.5f;
     
-    updateFilters();
+    //design everything once up front, after this the designer thread keeps the coefficients coming
+    //new chains in the pool start from scratch, so make sure every band gets applied
+    appliedBandVersions = {};
+    appliedSideBandVersions = {};
+    midSideActive = false;
+    floatChains.setMidSide(false);
+    doubleChains.setMidSide(false);
+    doubleFiltersActive = isUsingDoublePrecision() || filterPrecisionParameter->load() > 0.5f;
+    coefficientDesigner.prepare(sampleRate, maxOversamplingOrder);
+    if (coefficientDesigner.pullLatest())
+        updateFilters(coefficientDesigner.getLatest());
+    updateOversampling(coefficientDesigner.getLatest().oversamplingOrder, (int)oversamplingFilterParameter->load());
+
+    heldBands = 0;
+    numParameterEvents = 0;
+    for (auto& mapping : ccMappings)
+        mapping.pendingValue = -1.f;
+
+    silenceDetector.reset();
+    updateTailLength();
+
+    //nothing to fade from on a fresh start
+    mainFader.reset(sampleRate, bandFadeSeconds);
+    mainFader.snapTo(coefficientDesigner.getLatest());
+    sideFader.reset(sampleRate, bandFadeSeconds);
+    sideFader.snapTo(coefficientDesigner.getLatestSide());
+
+    chainSmoother.reset(sampleRate, smoothingRampSeconds);
+    chainSmoother.setCurrentAndTarget(chainSettingsTracker.getCurrentSettings());
 
 
     leftChannelFifo.prepare(samplesPerBlock);
@@ -122,6 +190,7 @@ void RomalEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    coefficientDesigner.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -132,11 +201,17 @@ bool RomalEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // mono, stereo and the immersive layouts we're after: 5.1, 7.1.4 and ambisonics up to 3rd order
+    // every channel gets chains in both precisions and oversamplers for every factor, so anything wider isn't offered
+    const auto& mainOutput = layouts.getMainOutputChannelSet();
+    auto isSupported = mainOutput == juce::AudioChannelSet::mono()
+                    || mainOutput == juce::AudioChannelSet::stereo()
+                    || mainOutput == juce::AudioChannelSet::create5point1()
+                    || mainOutput == juce::AudioChannelSet::create7point1point4();
+    for (int order = 1; order <= maxAmbisonicOrder; ++order)
+        isSupported = isSupported || mainOutput == juce::AudioChannelSet::ambisonic(order);
+
+    if (!isSupported)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -150,7 +225,23 @@ bool RomalEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 }
 #endif
 
+bool RomalEQAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
 void RomalEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+
+void RomalEQAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer, midiMessages);
+}
+
+template<typename SampleType>
+void RomalEQAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -167,18 +258,14 @@ void RomalEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
 
 
 
-    //update parameters before running audio through them
-    updateFilters();
-
-
-
-
+    auto plan = planBlock<SampleType>(midiMessages, buffer.getNumChannels());
+    auto sleepThisBlock = silenceDetector.update(buffer, totalNumInputChannels);
 
     //processor chain requires processing context to be passed into it in order to run audio through links in the chain
     // processing context needs an audio block instance
     // audio block is initialized with whatever processBlock buffer we are given by the audioprocessor
     //audio block -> seperate into channel blocks -> pass into contexts -> initialize mono chains with context
-    juce::dsp::AudioBlock<float> block(buffer);
+    juce::dsp::AudioBlock<SampleType> block(buffer);
 
     //oscilator producing sin wave for debugging
     /*
@@ -187,16 +274,592 @@ void RomalEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce
     osc.process(stereoContext);
     */
 
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    if ((sleepThisBlock || isIdle()) && numParameterEvents == 0)
+    {
+        //silent input that everything has rung out from, or every band off or flat with nothing fading:
+        //either way the output is the input
+        //a ramp still has to move on, a band switching on later picks it up from the right place
+        if (plan.ramp)
+            chainSmoother.advance((int)block.getNumSamples());
+    }
+    else if (linearPhaseActive)
+    {
+        auto numProcessedChannels = juce::jmin(buffer.getNumChannels(), getChainsForSampleType<SampleType>().getNumChannels());
+        auto channelsBlock = block.getSubsetChannelBlock(0, juce::jmin(block.getNumChannels(), (size_t)numProcessedChannels));
+        linearPhaseEngine.process(channelsBlock);
+    }
+    else if (plan.ramp || plan.dynamic || plan.fade || numParameterEvents > 0)
+    {
+        processSegments(block, plan);
+    }
+    else
+    {
+        processChains(block);
+    }
+
+    if (silenceDetector.advance((int)block.getNumSamples(), getSilenceSamples()))
+    {
+        resetChains();
+        linearPhaseEngine.reset();
+        peakDynamics.reset();
+    }
+
+    if (numParameterEvents > 0)
+    {
+        //the linear phase kernel comes from the designer, so there the events only move the parameters
+        if (linearPhaseActive)
+            for (int i = 0; i < numParameterEvents; ++i)
+                applyParameterEvent(parameterEvents[(size_t)i]);
+
+        queueParameterEvents();
+    }
+
+    if (analyzerTapEnabled.load())
+    {
+        leftChannelFifo.update(buffer);
+        rightChannelFifo.update(buffer);
+    }
+
+}
+
+template<typename SampleType>
+RomalEQAudioProcessor::BlockPlan RomalEQAudioProcessor::planBlock(const juce::MidiBuffer& midiMessages, int numChannels)
+{
+    BlockPlan plan;
+
+    //smoothing mode: ramp towards the latest parameter values and re-derive coefficients every sub-block
+    plan.subBlockSize = getSmoothingSubBlockSize();
+    if (plan.subBlockSize > 0)
+    {
+        auto targetSettings = chainSettingsTracker.getCurrentSettings();
+        if (smoothingWasEnabled)
+            chainSmoother.setTarget(targetSettings);
+        else
+            chainSmoother.setCurrentAndTarget(targetSettings);
+    }
+    smoothingWasEnabled = plan.subBlockSize > 0;
+
+    //the linear phase engine crossfades between kernels instead, so it never ramps
+    setLinearPhaseActive(phaseModeParameter->load() > 0.5f);
+
+    //mixed mode: float in and out, but the filter state and maths in double
+    setDoubleFiltersActive(std::is_same_v<SampleType, double> || filterPrecisionParameter->load() > 0.5f);
+
+    //mid/side needs a stereo pair, and the linear phase kernel is shared by every channel so it stays linked
+    auto numProcessedChannels = juce::jmin(numChannels, getChainsForSampleType<SampleType>().getNumChannels());
+    setMidSideActive(stereoModeParameter->load() > 0.5f && numProcessedChannels == 2 && !linearPhaseActive);
+
+    plan.ramp = smoothingWasEnabled && chainSmoother.isSmoothing() && !linearPhaseActive;
+
+    //the smoothed set only follows the settings while it's the one running, the next ramp starts it over
+    if (!plan.ramp)
+        chainSmoother.markBandsToDesign(ChainBands::AllBands);
+
+    //timestamped parameter changes for this block, applied where they land further down
+    collectParameterEvents(midiMessages);
+
+    pickUpDesignedSet(plan.ramp);
+
+    //bands switching on or off in the new set fade rather than jump (linear phase crossfades whole kernels instead)
+    if (!linearPhaseActive)
+        startFades();
+
+    //the set we run was designed for a particular rate, so the oversampling factor follows it
+    updateOversampling(getMainCoefficients().oversamplingOrder, (int)oversamplingFilterParameter->load());
+    updateTailLength();
+
+    plan.dynamic = updateDynamics(plan.ramp);
+
+    //the side fader only means anything while the side set is running
+    plan.sideFade = midSideActive && sideFader.isFading();
+    plan.fade = mainFader.isFading() || plan.sideFade;
+    return plan;
+}
+
+void RomalEQAudioProcessor::pickUpDesignedSet(bool ramp)
+{
+    //update parameters before running audio through them
+    //coefficients are designed on the designer thread, here we only pick up a finished set
+    if (coefficientDesigner.pullLatest())
+    {
+        //bands moved by parameter events go back to the designer once it has caught up with them
+        auto releasedBands = releaseHeldBands();
+
+        //while ramping the sub-blocks design the moving bands from the newest settings,
+        //so just note the designer's versions instead of jumping to its coefficients
+        if (ramp)
+            appliedBandVersions = getMainCoefficients().bandVersions;
+        else
+            applyToChains(getMainCoefficients(), takeChangedBands(getMainCoefficients(), appliedBandVersions) | releasedBands);
+
+        //the side chain doesn't ramp, it always runs the designer's set
+        updateSideFilters(coefficientDesigner.getLatestSide());
+    }
+    else if (heldBands != 0)
+    {
+        //a queued value that didn't actually change the parameter bumps no version, so no new set comes for it
+        auto releasedBands = releaseHeldBands();
+        if (!ramp)
+            applyToChains(getMainCoefficients(), releasedBands);
+    }
+}
+
+bool RomalEQAudioProcessor::updateDynamics(bool ramp)
+{
+    //dynamic peak: re-gain the peak every control interval from the detector
+    auto dynamicThisBlock = !linearPhaseActive && peakDynamicParameter->load() > 0.5f && !getMainCoefficients().peakBypassed;
+    if (dynamicThisBlock)
+    {
+        peakDynamics.setParameters(peakThresholdParameter->load(), peakRatioParameter->load(),
+                                   peakAttackParameter->load(), peakReleaseParameter->load());
+    }
+    else if (dynamicWasActive)
+    {
+        //put the static peak back (a ramp re-designs it from the smoothed settings instead)
+        peakDynamics.reset();
+        if (ramp)
+            chainSmoother.markBandsToDesign(ChainBands::PeakBand);
+        else
+            applyToChains(getMainCoefficients(), ChainBands::PeakBand);
+    }
+    dynamicWasActive = dynamicThisBlock;
+    return dynamicThisBlock;
+}
+
+template<typename SampleType>
+void RomalEQAudioProcessor::processSegments(juce::dsp::AudioBlock<SampleType>& block, BlockPlan& plan)
+{
+    auto numSamples = (int)block.getNumSamples();
+    auto minimumSegmentLength = getMinimumSegmentLength();
+    auto nextEvent = 0;
+    if (numParameterEvents > 0)
+        beginParameterEvents();
+
+    for (int start = 0; start < numSamples;)
+    {
+        applyEventsUpTo(start, nextEvent, plan);
+
+        //segments are a smoothing sub-block or a control interval long, whichever is shorter,
+        //and end early at the next event, but never shorter than the minimum
+        auto segmentSize = plan.ramp ? plan.subBlockSize : numSamples;
+        if (plan.dynamic || mainFader.isFading() || (plan.sideFade && sideFader.isFading()))
+            segmentSize = juce::jmin(segmentSize, controlInterval);
+
+        auto length = juce::jmin(segmentSize, numSamples - start);
+        if (nextEvent < numParameterEvents)
+            length = juce::jmin(length, juce::jmax(minimumSegmentLength, parameterEvents[(size_t)nextEvent].samplePosition - start));
+
+        auto segment = block.getSubBlock((size_t)start, (size_t)length);
+        const auto& segmentCoefficients = advanceSegment(length, plan);
+        if (plan.dynamic)
+            applyDynamics(segment, segmentCoefficients);
+
+        processChains(segment);
+        start += length;
+    }
+}
+
+void RomalEQAudioProcessor::applyEventsUpTo(int position, int& nextEvent, BlockPlan& plan)
+{
+    //events land at the start of the first segment at or after their timestamp
+    auto eventBands = 0;
+    while (nextEvent < numParameterEvents && parameterEvents[(size_t)nextEvent].samplePosition <= position)
+        eventBands |= applyParameterEvent(parameterEvents[(size_t)nextEvent++]);
+
+    if (eventBands == 0)
+        return;
+
+    //from here on the event set is the main set, for those bands at least
+    designChainCoefficients(eventSettings, getSampleRate(), eventBands, eventCoefficients, &coefficientDesigner.getCutTable());
+    heldBands |= eventBands;
+
+    //with smoothing on the event is a new target to ramp to, otherwise it applies right here
+    if (smoothingWasEnabled)
+    {
+        chainSmoother.setTarget(eventSettings);
+        plan.ramp = true;
+    }
+    else
+    {
+        applyToChains(eventCoefficients, eventBands);
+    }
+    startFades();
+}
+
+const ChainCoefficients& RomalEQAudioProcessor::advanceSegment(int length, const BlockPlan& plan)
+{
+    const auto* segmentCoefficients = &getMainCoefficients();
+
+    auto rampedBands = 0;
+    if (plan.ramp)
+    {
+        //cheap re-derivation per sub-block instead of a per sample redesign, and only of the bands still moving
+        chainSmoother.advance(length);
+        auto settings = chainSmoother.getCurrent();
+        settings.oversamplingOrder = oversamplingOrder;
+        rampedBands = chainSmoother.takeBandsToDesign();
+        if (rampedBands != 0)
+            designChainCoefficients(settings, getSampleRate(), rampedBands, smoothedCoefficients, &coefficientDesigner.getCutTable());
+        segmentCoefficients = &smoothedCoefficients;
+    }
+
+    //the faded set only differs from the source in the fading and the re-designed bands
+    //(a ramping set can have bands on that have already faded out, the faded copy keeps them off)
+    if (mainFader.isFading() || rampedBands != 0)
+    {
+        auto fadedBands = mainFader.advance(length);
+        mainFader.applyFades(*segmentCoefficients, fadedCoefficients);
+        applyToChains(fadedCoefficients, fadedBands | rampedBands);
+    }
+
+    if (plan.sideFade && sideFader.isFading())
+    {
+        auto fadedBands = sideFader.advance(length);
+        sideFader.applyFades(coefficientDesigner.getLatestSide(), fadedSideCoefficients);
+        applySideToChains(fadedSideCoefficients, fadedBands);
+    }
+
+    return *segmentCoefficients;
+}
+
+template<typename SampleType>
+void RomalEQAudioProcessor::applyDynamics(const juce::dsp::AudioBlock<SampleType>& segment, const ChainCoefficients& segmentCoefficients)
+{
+    //the detector looks at this segment's input and the new gain applies to it straight away
+    auto gainChange = peakDynamics.process(segment, segmentCoefficients.peakDetector, midSideActive);
+    auto gain = juce::Decibels::decibelsToGain(segmentCoefficients.peakGainInDecibels + gainChange);
+    applyPeakToChains(withWetLevel(segmentCoefficients.peakPrototype.withGain<double>(gain),
+                                   (double)mainFader.getLevel(ChainPositions::Peak)));
+}
+
+template<typename SampleType>
+void RomalEQAudioProcessor::processChains(juce::dsp::AudioBlock<SampleType>& block)
+{
+    //the oversampler works at the I/O precision, the filters in between may not (mixed mode)
+    auto& ioChains = getChainsForSampleType<SampleType>();
+
+    //never index past the channels we actually have (or the pool prepareToPlay sized)
+    auto numChannels = juce::jmin(block.getNumChannels(), (size_t)ioChains.getNumChannels());
+    auto channelsBlock = block.getSubsetChannelBlock(0, numChannels);
+    auto* oversampler = ioChains.getOversampler();
+
+    if (oversampler == nullptr)
+    {
+        processEngine(channelsBlock);
+        return;
+    }
+
+    //buffers were allocated by initProcessing in prepareToPlay, so this is allocation free
+    auto oversampledBlock = oversampler->processSamplesUp(channelsBlock);
+    processEngine(oversampledBlock);
+    oversampler->processSamplesDown(channelsBlock);
+}
+
+template<typename SampleType>
+void RomalEQAudioProcessor::processEngine(juce::dsp::AudioBlock<SampleType>& block)
+{
+    auto useVectorChain = processingEngine.load() == VectorChainEngine;
+
+    //double blocks always go through the double chains, so the float chains never see one
+    if constexpr (std::is_same_v<SampleType, double>)
+        doubleChains.process(block, useVectorChain, midSideActive);
+    else if (doubleFiltersActive)
+        doubleChains.process(block, useVectorChain, midSideActive);
+    else
+        floatChains.process(block, useVectorChain, midSideActive);
+}
+
+void RomalEQAudioProcessor::setMidSideActive(bool shouldBeActive)
+{
+    if (shouldBeActive == midSideActive)
+        return;
+
+    midSideActive = shouldBeActive;
+    floatChains.setMidSide(midSideActive);
+    doubleChains.setMidSide(midSideActive);
+
+    //the state was built from L/R (or M/S), it means nothing in the other encoding
+    resetChains();
+
+    //channel 1 / lane 1 switches between the side set and the main set
+    if (midSideActive)
+    {
+        appliedSideBandVersions = coefficientDesigner.getLatestSide().bandVersions;
+        applySideToChains(coefficientDesigner.getLatestSide(), ChainBands::AllBands);
+        sideFader.snapTo(coefficientDesigner.getLatestSide());
+    }
+    else
+    {
+        applyToChains(getMainCoefficients(), ChainBands::AllBands);
+    }
+}
+
+void RomalEQAudioProcessor::startFades()
+{
+    //bands fading in from fully off start from cleared state, anything else carries on from where it is
+    auto mainFadingIn = mainFader.setTarget(getMainCoefficients());
+    forActiveChains([this, mainFadingIn](auto& chains) { chains.resetBands(mainFadingIn, midSideActive); });
+
+    if (midSideActive)
+    {
+        auto sideFadingIn = sideFader.setTarget(coefficientDesigner.getLatestSide());
+        forActiveChains([sideFadingIn](auto& chains) { chains.resetSideBands(sideFadingIn); });
+    }
+}
+
+bool RomalEQAudioProcessor::isIdle() const
+{
+    //oversampling still adds its latency (and filtering) with every band off, so it has to keep running
+    //(a ramp doesn't matter: bands the designer's set has off stay off in the faded set)
+    if (linearPhaseActive || oversamplingOrder != 0)
+        return false;
+    if (mainFader.isFading() || (midSideActive && sideFader.isFading()))
+        return false;
+
+    return !hasActiveBands(getMainCoefficients())
+        && !(midSideActive && hasActiveBands(coefficientDesigner.getLatestSide()));
+}
+
+int RomalEQAudioProcessor::getSilenceSamples() const
+{
+    if (linearPhaseActive)
+        return linearPhaseEngine.getLatencySamples() + linearPhaseEngine.getTailSamples();
+
+    auto samples = coefficientDesigner.getLatestSilenceSeconds() * getSampleRate();
+
+    //the oversampling filters ring too, their latency times a generous factor covers that
+    if (auto* oversampler = floatChains.getOversampler())
+        samples += 4.0 * oversampler->getLatencyInSamples();
+
+    return samples < (double)std::numeric_limits<int>::max() ? (int)std::ceil(samples) : std::numeric_limits<int>::max();
+}
+
+void RomalEQAudioProcessor::updateTailLength()
+{
+    //the host gets the ring after the latency it already knows about
+    if (linearPhaseActive)
+        tailLengthSeconds.store(linearPhaseEngine.getTailSamples() / getSampleRate());
+    else
+        tailLengthSeconds.store(coefficientDesigner.getLatestTailSeconds());
+}
+
+void RomalEQAudioProcessor::setDoubleFiltersActive(bool shouldBeActive)
+{
+    if (shouldBeActive == doubleFiltersActive)
+        return;
+
+    doubleFiltersActive = shouldBeActive;
+
+    //the chains taking over missed every update while they were idle, so bring them fully up to date
+    forActiveChains([this](auto& chains)
+    {
+        chains.reset();
+        chains.applyCoefficients(getMainCoefficients(), ChainBands::AllBands, midSideActive);
+        if (midSideActive)
+            chains.applySideCoefficients(coefficientDesigner.getLatestSide(), ChainBands::AllBands);
+    });
+}
+
+void RomalEQAudioProcessor::resetChains()
+{
+    floatChains.reset();
+    doubleChains.reset();
+}
+
+void RomalEQAudioProcessor::updateOversampling(int newOrder, int newFilterType)
+{
+    if (newOrder == oversamplingOrder && newFilterType == oversamplingFilterType)
+        return;
+
+    //filter state from another rate is meaningless, just start the chains from silence
+    if (newOrder != oversamplingOrder)
+        resetChains();
+
+    oversamplingOrder = newOrder;
+    oversamplingFilterType = newFilterType;
+    floatChains.selectOversampler(oversamplingOrder, oversamplingFilterType);
+    doubleChains.selectOversampler(oversamplingOrder, oversamplingFilterType);
+
+    updateLatency();
+}
+
+void RomalEQAudioProcessor::setLinearPhaseActive(bool shouldBeActive)
+{
+    if (shouldBeActive == linearPhaseActive)
+        return;
+
+    linearPhaseActive = shouldBeActive;
+
+    //whichever path takes over has stale state from the last time it ran
+    if (linearPhaseActive)
+    {
+        linearPhaseEngine.reset();
+    }
+    else
+    {
+        resetChains();
+        floatChains.selectOversampler(oversamplingOrder, oversamplingFilterType);
+        doubleChains.selectOversampler(oversamplingOrder, oversamplingFilterType);
+    }
+
+    updateLatency();
+}
+
+void RomalEQAudioProcessor::updateLatency()
+{
+    if (linearPhaseActive)
+        setLatencySamples(linearPhaseEngine.getLatencySamples());
+    else
+    {
+        //float and double oversamplers are the same design, so either one gives the latency
+        auto* oversampler = floatChains.getOversampler();
+        setLatencySamples(oversampler != nullptr ? juce::roundToInt(oversampler->getLatencyInSamples()) : 0);
+    }
+}
+
+const ChainCoefficients& RomalEQAudioProcessor::getMainCoefficients() const
+{
+    return heldBands != 0 ? eventCoefficients : coefficientDesigner.getLatest();
+}
+
+void RomalEQAudioProcessor::collectParameterEvents(const juce::MidiBuffer& midiMessages)
+{
+    //any MIDI channel, the buffer is already in timestamp order
+    numParameterEvents = 0;
+    for (const auto metadata : midiMessages)
+    {
+        auto message = metadata.getMessage();
+        if (!message.isController())
+            continue;
+
+        for (size_t i = 0; i < ccMappings.size(); ++i)
+        {
+            auto controllerNumber = (int)ccMappings[i].controllerNumber->load();
+            if (controllerNumber == 0 || controllerNumber != message.getControllerNumber())
+                continue;
+
+            //once full the newest event takes the last slot, so the block still ends on the right value
+            auto slot = juce::jmin(numParameterEvents, maxParameterEvents - 1);
+            parameterEvents[(size_t)slot] = { metadata.samplePosition, (int)i, message.getControllerValue() / 127.f };
+            numParameterEvents = slot + 1;
+        }
+    }
+}
+
+int RomalEQAudioProcessor::applyParameterEvent(const ParameterEvent& event)
+{
+    auto& mapping = ccMappings[(size_t)event.mapping];
+    eventSettings.*mapping.setting = mapping.parameter->convertFrom0to1(event.value);
+    mapping.pendingValue = event.value;
+    return 1 << mapping.position;
+}
+
+void RomalEQAudioProcessor::beginParameterEvents()
+{
+    eventSettings = chainSettingsTracker.getCurrentSettings();
+    if (heldBands == 0)
+        eventCoefficients = coefficientDesigner.getLatest();
+
+    //the events move bands, not the oversampling factor the chains are running
+    eventSettings.oversamplingOrder = eventCoefficients.oversamplingOrder;
+}
 
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+void RomalEQAudioProcessor::queueParameterEvents()
+{
+    for (size_t i = 0; i < ccMappings.size(); ++i)
+    {
+        auto& mapping = ccMappings[i];
+        if (mapping.pendingValue < 0.f)
+            continue;
+
+        //a full queue drops the value, the band then goes back to the parameter once the rest is through
+        parameterValueQueue.push((int)i, mapping.pendingValue, mapping.position);
+        mapping.pendingValue = -1.f;
+    }
+}
 
+void RomalEQAudioProcessor::timerCallback()
+{
+    parameterValueQueue.drain([this](int mappingIndex, float value)
+    {
+        //a gesture around each value, so the host treats it like a user moving the control:
+        //recorded in touch / latch, and not fought by automation being read back
+        //the tracker bumps the band's version in here, any designer set from that version on has the value
+        const auto& mapping = ccMappings[(size_t)mappingIndex];
+        mapping.parameter->beginChangeGesture();
+        mapping.parameter->setValueNotifyingHost(value);
+        mapping.parameter->endChangeGesture();
+        return chainSettingsTracker.getVersion(mapping.position);
+    });
+
+    //the last mapping went away and everything queued before that is through
+    if (!isAnyControllerMapped())
+        stopTimer();
+}
+
+void RomalEQAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    juce::ignoreUnused(parameterID, newValue);
+
+    //timers are started from the message thread, a mapping changed anywhere else gets picked up by the next change there
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        updateParameterTimer();
+}
+
+bool RomalEQAudioProcessor::isAnyControllerMapped() const
+{
+    for (const auto& mapping : ccMappings)
+        if ((int)mapping.controllerNumber->load() != 0)
+            return true;
+
+    return false;
+}
+
+void RomalEQAudioProcessor::updateParameterTimer()
+{
+    //stopping is left to timerCallback, so values queued before the last mapping went away still get set
+    if (isAnyControllerMapped() && !isTimerRunning())
+        startTimerHz(30);
+}
+
+int RomalEQAudioProcessor::releaseHeldBands()
+{
+    if (heldBands == 0)
+        return 0;
+
+    const auto& latest = coefficientDesigner.getLatest();
+    const auto& designedVersions = coefficientDesigner.getLatestSettingsVersions();
+    auto releasedBands = 0;
+    for (size_t position = 0; position < (size_t)numSetBands; ++position)
+    {
+        if (!(heldBands & (1 << position)))
+            continue;
+
+        //every value queued for the band has to be set first, then the designer has to have caught up with the last one
+        //versions wrap, so compare the difference
+        if (parameterValueQueue.isBandSet((int)position)
+            && static_cast<juce::int32>(designedVersions[position] - parameterValueQueue.getSetVersion((int)position)) >= 0)
+            releasedBands |= 1 << position;
+    }
+    heldBands &= ~releasedBands;
+
+    //everything else follows the designer as usual
+    copyBands(latest, eventCoefficients, ~heldBands);
+    eventCoefficients.oversamplingOrder = latest.oversamplingOrder;
+    return releasedBands;
+}
+
+int RomalEQAudioProcessor::getMinimumSegmentLength() const
+{
+    //choice index: 16, 32, 64 or 128 samples
+    return 16 << (int)minimumSegmentParameter->load();
+}
+
+int RomalEQAudioProcessor::getSmoothingSubBlockSize() const
+{
+    //choice index: 0 = off, 1 = 16 samples, 2 = 32 samples
+    auto choice = (int)smoothingParameter->load();
+    return choice == 0 ? 0 : 8 << choice;
 }
 
 //==============================================================================
@@ -237,7 +900,8 @@ void RomalEQAudioProcessor::setStateInformation (const void* data, int sizeInByt
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid()) {
         apvts.replaceState(tree);
-        updateFilters();
+        //let the audio thread pick the new state up on its next block instead of touching the chains from here
+        chainSettingsTracker.markAllDirty();
     }
 }
 
@@ -299,102 +963,604 @@ juce::AudioProcessorValueTreeState::ParameterLayout RomalEQAudioProcessor::creat
     layout.add(std::make_unique<juce::AudioParameterBool>("HighCut Bypassed", "HighCut Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Peak Bypassed", "Peak Bypassed", false));
     layout.add(std::make_unique<juce::AudioParameterBool>("Analyzer Enabled", "Analyzer Enabled", false));
+
+    //automation smoothing: off, or re-derive the coefficients every 16 / 32 samples while parameters ramp
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Smoothing", "Smoothing", juce::StringArray{ "Off", "16 Samples", "32 Samples" }, 0));
+
+    //dynamic peak: once the band-passed input goes over the threshold, peak gain gets pulled down by the ratio
+    layout.add(std::make_unique<juce::AudioParameterBool>("Peak Dynamic", "Peak Dynamic", false));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Threshold", "Peak Threshold", juce::NormalisableRange<float>(-60.f, 0.f, 0.5f, 1.0f), -18.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Ratio", "Peak Ratio", juce::NormalisableRange<float>(1.f, 20.f, 0.1f, 0.5f), 2.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Attack", "Peak Attack", juce::NormalisableRange<float>(0.1f, 200.f, 0.1f, 0.4f), 10.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Peak Release", "Peak Release", juce::NormalisableRange<float>(5.f, 2000.f, 1.f, 0.4f), 150.f));
+
+    //oversampling keeps the peak and highcut from cramping near nyquist, at the cost of cpu and (reported) latency
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", juce::StringArray{ "Off", "2x", "4x" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling Filter", "Oversampling Filter", juce::StringArray{ "Min Phase IIR", "Linear Phase FIR" }, 0));
+
+    //linear phase runs the same response as one long FIR, for mastering, at ~100ms of latency at 44.1/48kHz
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Phase Mode", "Phase Mode", juce::StringArray{ "Minimum Phase", "Linear Phase" }, 0));
+
+    //extra bands go last so every parameter above keeps its index, older sessions just load them as Off
+    //(the mid/side parameters after them follow the same rule)
+    juce::StringArray bandTypes{ "Off", "Peak", "Low Shelf", "High Shelf", "Notch", "Low Pass", "High Pass" };
+    for (int i = 0; i < maxExtraBands; ++i)
+    {
+        auto typeID = getExtraBandParameterID(i, "Type");
+        auto freqID = getExtraBandParameterID(i, "Freq");
+        auto gainID = getExtraBandParameterID(i, "Gain");
+        auto qualityID = getExtraBandParameterID(i, "Quality");
+
+        //same ranges as the peak band
+        layout.add(std::make_unique<juce::AudioParameterChoice>(typeID, typeID, bandTypes, 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(freqID, freqID, juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 1000.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(gainID, gainID, juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.0f), 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(qualityID, qualityID, juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.0f), 1.0f));
+    }
+
+    //mid/side: the main lowcut/peak/highcut and the extra bands work on the mid channel,
+    //the side channel gets the extra bands plus its own lowcut/peak/highcut below
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Stereo Mode", "Stereo Mode", juce::StringArray{ "L/R Linked", "Mid/Side" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side LowCut Freq", "Side LowCut Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side HighCut Freq", "Side HighCut Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 20000.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Freq", "Side Peak Freq", juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 0.25f), 750.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Gain", "Side Peak Gain", juce::NormalisableRange<float>(-24.f, 24.f, 0.5f, 1.0f), 0.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Side Peak Quality", "Side Peak Quality", juce::NormalisableRange<float>(0.1f, 10.f, 0.05f, 1.0f), 1.0f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Side LowCut Slope", "Side LowCut Slope", stringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Side HighCut Slope", "Side HighCut Slope", stringArray, 0));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Side LowCut Bypassed", "Side LowCut Bypassed", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Side HighCut Bypassed", "Side HighCut Bypassed", false));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Side Peak Bypassed", "Side Peak Bypassed", false));
+
+    //float hosts can still run the filters in double, for very low cutoffs at high sample rates
+    //(hosts that process in double get double filters either way)
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Filter Precision", "Filter Precision", juce::StringArray{ "Single", "Double" }, 0));
+
+    //MIDI CC numbers that move the core bands sample accurately, 0 = not mapped (CC 0 is bank select anyway)
+    layout.add(std::make_unique<juce::AudioParameterInt>("CC LowCut Freq", "CC LowCut Freq", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("CC Peak Freq", "CC Peak Freq", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("CC Peak Gain", "CC Peak Gain", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("CC Peak Quality", "CC Peak Quality", 0, 127, 0));
+    layout.add(std::make_unique<juce::AudioParameterInt>("CC HighCut Freq", "CC HighCut Freq", 0, 127, 0));
+    //the shortest piece a block gets split into at those events
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Min Segment Length", "Min Segment Length", juce::StringArray{ "16 Samples", "32 Samples", "64 Samples", "128 Samples" }, 1));
+
+    //how much consecutive analyzer windows overlap, the analyzer only ever transforms the newest one
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Overlap", "Analyzer Overlap", juce::StringArray{ "50%", "75%" }, 0));
+    //analyzer fft size, bigger ones resolve the low end better but react slower
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Resolution", "Analyzer Resolution", juce::StringArray{ "2048", "4096", "8192" }, 0));
+    //analyzer ballistics: averaging time, peak hold decay and fractional octave smoothing
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Averaging", "Analyzer Averaging", juce::StringArray{ "Off", "100 ms", "300 ms", "1 s" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Peak Hold", "Analyzer Peak Hold", juce::StringArray{ "Off", "6 dB/s", "12 dB/s", "24 dB/s" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Smoothing", "Analyzer Smoothing", juce::StringArray{ "Off", "1/12 Octave", "1/6 Octave", "1/3 Octave" }, 0));
+    //stereo adds mid and side spectra and the phase correlation, from one transform per frame
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Analyzer Mode", "Analyzer Mode", juce::StringArray{ "Left/Right", "Stereo" }, 0));
     return layout;
 
 }
 
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts) {
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, const juce::String& coreBandPrefix) {
     //puts apvts params into our Chain Settings struct for cleaner code
 
     ChainSettings settings;
-    settings.lowCutFreq = apvts.getRawParameterValue("LowCut Freq")->load();
-    settings.highCutFreq = apvts.getRawParameterValue("HighCut Freq")->load();
-    settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
-    settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
-    settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
-    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue("LowCut Slope")->load());
-    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue("HighCut Slope")->load());
-
-    settings.lowCutBypassed = apvts.getRawParameterValue("LowCut Bypassed")->load() > 0.5;
-    settings.highCutBypassed = apvts.getRawParameterValue("HighCut Bypassed")->load() > 0.5;
-    settings.peakBypassed = apvts.getRawParameterValue("Peak Bypassed")->load() > 0.5;
+    settings.lowCutFreq = apvts.getRawParameterValue(coreBandPrefix + "LowCut Freq")->load();
+    settings.highCutFreq = apvts.getRawParameterValue(coreBandPrefix + "HighCut Freq")->load();
+    settings.peakFreq = apvts.getRawParameterValue(coreBandPrefix + "Peak Freq")->load();
+    settings.peakGainInDecibels = apvts.getRawParameterValue(coreBandPrefix + "Peak Gain")->load();
+    settings.peakQuality = apvts.getRawParameterValue(coreBandPrefix + "Peak Quality")->load();
+    settings.lowCutSlope = static_cast<Slope>(apvts.getRawParameterValue(coreBandPrefix + "LowCut Slope")->load());
+    settings.highCutSlope = static_cast<Slope>(apvts.getRawParameterValue(coreBandPrefix + "HighCut Slope")->load());
+
+    settings.lowCutBypassed = apvts.getRawParameterValue(coreBandPrefix + "LowCut Bypassed")->load() > 0.5;
+    settings.highCutBypassed = apvts.getRawParameterValue(coreBandPrefix + "HighCut Bypassed")->load() > 0.5;
+    settings.peakBypassed = apvts.getRawParameterValue(coreBandPrefix + "Peak Bypassed")->load() > 0.5;
+    settings.peakDynamic = coreBandPrefix.isEmpty() && apvts.getRawParameterValue("Peak Dynamic")->load() > 0.5;
+    settings.oversamplingOrder = (int)apvts.getRawParameterValue("Oversampling")->load();
+
+    for (int i = 0; i < maxExtraBands; ++i)
+    {
+        auto& band = settings.extraBands[(size_t)i];
+        band.type = static_cast<BandType>(apvts.getRawParameterValue(getExtraBandParameterID(i, "Type"))->load());
+        band.freq = apvts.getRawParameterValue(getExtraBandParameterID(i, "Freq"))->load();
+        band.gainInDecibels = apvts.getRawParameterValue(getExtraBandParameterID(i, "Gain"))->load();
+        band.quality = apvts.getRawParameterValue(getExtraBandParameterID(i, "Quality"))->load();
+    }
     return settings;
 }
 
+juce::String getExtraBandParameterID(int extraBandIndex, const juce::String& name) {
+    return "Band " + juce::String(extraBandIndex + 1) + " " + name;
+}
+
+
+void ChainSettingsSmoother::reset(double sampleRate, double rampLengthSeconds) {
+    lowCutFreq.reset(sampleRate, rampLengthSeconds);
+    highCutFreq.reset(sampleRate, rampLengthSeconds);
+    peakFreq.reset(sampleRate, rampLengthSeconds);
+    peakQuality.reset(sampleRate, rampLengthSeconds);
+    peakGain.reset(sampleRate, rampLengthSeconds);
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate) {
+    for (size_t i = 0; i < (size_t)maxExtraBands; ++i)
+    {
+        bandFreq[i].reset(sampleRate, rampLengthSeconds);
+        bandQuality[i].reset(sampleRate, rampLengthSeconds);
+        bandGain[i].reset(sampleRate, rampLengthSeconds);
+    }
+}
 
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality,
-        juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+void ChainSettingsSmoother::setCurrentAndTarget(const ChainSettings& settings) {
+    current = settings;
+    bandsToDesign = ChainBands::AllBands;
+    lowCutFreq.setCurrentAndTargetValue(settings.lowCutFreq);
+    highCutFreq.setCurrentAndTargetValue(settings.highCutFreq);
+    peakFreq.setCurrentAndTargetValue(settings.peakFreq);
+    peakQuality.setCurrentAndTargetValue(settings.peakQuality);
+    peakGain.setCurrentAndTargetValue(settings.peakGainInDecibels);
+
+    for (size_t i = 0; i < (size_t)maxExtraBands; ++i)
+    {
+        bandFreq[i].setCurrentAndTargetValue(settings.extraBands[i].freq);
+        bandQuality[i].setCurrentAndTargetValue(settings.extraBands[i].quality);
+        bandGain[i].setCurrentAndTargetValue(settings.extraBands[i].gainInDecibels);
+    }
+}
+
+void ChainSettingsSmoother::setTarget(const ChainSettings& settings) {
+    lowCutFreq.setTargetValue(settings.lowCutFreq);
+    highCutFreq.setTargetValue(settings.highCutFreq);
+    peakFreq.setTargetValue(settings.peakFreq);
+    peakQuality.setTargetValue(settings.peakQuality);
+    peakGain.setTargetValue(settings.peakGainInDecibels);
+
+    if (current.lowCutSlope != settings.lowCutSlope || current.lowCutBypassed != settings.lowCutBypassed)
+        bandsToDesign |= ChainBands::LowCutBand;
+    if (current.peakBypassed != settings.peakBypassed || current.peakDynamic != settings.peakDynamic)
+        bandsToDesign |= ChainBands::PeakBand;
+    if (current.highCutSlope != settings.highCutSlope || current.highCutBypassed != settings.highCutBypassed)
+        bandsToDesign |= ChainBands::HighCutBand;
+
+    current.lowCutSlope = settings.lowCutSlope;
+    current.highCutSlope = settings.highCutSlope;
+    current.lowCutBypassed = settings.lowCutBypassed;
+    current.peakBypassed = settings.peakBypassed;
+    current.highCutBypassed = settings.highCutBypassed;
+    current.peakDynamic = settings.peakDynamic;
+
+    for (size_t i = 0; i < (size_t)maxExtraBands; ++i)
+    {
+        bandFreq[i].setTargetValue(settings.extraBands[i].freq);
+        bandQuality[i].setTargetValue(settings.extraBands[i].quality);
+        bandGain[i].setTargetValue(settings.extraBands[i].gainInDecibels);
+        if (current.extraBands[i].type != settings.extraBands[i].type)
+            bandsToDesign |= getExtraBandBit((int)i);
+        current.extraBands[i].type = settings.extraBands[i].type;
+    }
 }
 
+bool ChainSettingsSmoother::isSmoothing() const {
+    if (lowCutFreq.isSmoothing() || highCutFreq.isSmoothing() || peakFreq.isSmoothing()
+        || peakQuality.isSmoothing() || peakGain.isSmoothing())
+        return true;
 
+    for (size_t i = 0; i < (size_t)maxExtraBands; ++i)
+        if (bandFreq[i].isSmoothing() || bandQuality[i].isSmoothing() || bandGain[i].isSmoothing())
+            return true;
 
-void RomalEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings) {
+    return false;
+}
 
-    //auto peakCoefficients = juce::dsp::IIR::Coefficients<float>::makePeakFilter(getSampleRate(), chainSettings.peakFreq, chainSettings.peakQuality,
-    //    juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+void ChainSettingsSmoother::advance(int numSamples) {
+    //a band counts if it was still moving going into this stretch, so the step that lands on the target is designed too
+    if (lowCutFreq.isSmoothing())
+        bandsToDesign |= ChainBands::LowCutBand;
+    if (highCutFreq.isSmoothing())
+        bandsToDesign |= ChainBands::HighCutBand;
+    if (peakFreq.isSmoothing() || peakQuality.isSmoothing() || peakGain.isSmoothing())
+        bandsToDesign |= ChainBands::PeakBand;
+
+    current.lowCutFreq = lowCutFreq.skip(numSamples);
+    current.highCutFreq = highCutFreq.skip(numSamples);
+    current.peakFreq = peakFreq.skip(numSamples);
+    current.peakQuality = peakQuality.skip(numSamples);
+    current.peakGainInDecibels = peakGain.skip(numSamples);
+
+    for (size_t i = 0; i < (size_t)maxExtraBands; ++i)
+    {
+        if (bandFreq[i].isSmoothing() || bandQuality[i].isSmoothing() || bandGain[i].isSmoothing())
+            bandsToDesign |= getExtraBandBit((int)i);
+
+        current.extraBands[i].freq = bandFreq[i].skip(numSamples);
+        current.extraBands[i].quality = bandQuality[i].skip(numSamples);
+        current.extraBands[i].gainInDecibels = bandGain[i].skip(numSamples);
+    }
+}
 
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
+int ChainSettingsSmoother::takeBandsToDesign() {
+    auto bands = bandsToDesign;
+    bandsToDesign = 0;
+    return bands;
+}
 
-    //*leftChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients;
-    //*rightChain.get<ChainPositions::Peak>().coefficients = *peakCoefficients;
 
-    leftChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
-    rightChain.setBypassed<ChainPositions::Peak>(chainSettings.peakBypassed);
+void BandFader::reset(double sampleRate, double fadeLengthSeconds) {
+    for (auto& level : levels)
+        level.reset(sampleRate, fadeLengthSeconds);
+    fadingBands = 0;
+}
+
+void BandFader::snapTo(const ChainCoefficients& coefficients) {
+    for (int position = 0; position < numSetBands; ++position)
+        levels[(size_t)position].setCurrentAndTargetValue(isBandActive(coefficients, position) ? 1.f : 0.f);
+    fadingBands = 0;
+}
+
+int BandFader::setTarget(const ChainCoefficients& coefficients) {
+    int fadingIn = 0;
+    for (int position = 0; position < numSetBands; ++position)
+    {
+        auto& level = levels[(size_t)position];
+        auto target = isBandActive(coefficients, position) ? 1.f : 0.f;
+        if (level.getTargetValue() == target)
+            continue;
+
+        //a band coming back from fully off has stale state from whenever it last ran
+        if (level.getCurrentValue() == 0.f)
+            fadingIn |= 1 << position;
+
+        level.setTargetValue(target);
+        fadingBands |= 1 << position;
+    }
+    return fadingIn;
+}
 
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+int BandFader::advance(int numSamples) {
+    auto wasFading = fadingBands;
+    for (int position = 0; position < numSetBands; ++position)
+    {
+        if ((wasFading & (1 << position)) == 0)
+            continue;
+
+        auto& level = levels[(size_t)position];
+        level.skip(numSamples);
+        if (!level.isSmoothing())
+            fadingBands &= ~(1 << position);
+    }
+    return wasFading;
 }
 
-void /*RomalEQAudioProcessor::*/updateCoefficients(Coefficients& old, const Coefficients& replacements) {
-    *old = *replacements;
+void BandFader::applyFades(const ChainCoefficients& source, ChainCoefficients& faded) const {
+    faded = source;
+    for (int position = 0; position < numSetBands; ++position)
+    {
+        auto& level = levels[(size_t)position];
+        if (level.isSmoothing())
+            setBandWetLevel(faded, position, level.getCurrentValue());
+        else if (level.getTargetValue() == 0.f)
+            setBandActive(faded, position, false);
+    }
 }
 
 
-void RomalEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings) {
 
-        //butterworthmethod args
-    //frequency, samplerate, order
-    // order returns order/2 sets of coefficients
+void designChainCoefficients(const ChainSettings& chainSettings, double sampleRate, int bandsToDesign, ChainCoefficients& coefficients,
+                             const CutFilterTable* cutTable) {
+
+    //a different oversampling order means a different design rate for every band
+    if (chainSettings.oversamplingOrder != coefficients.oversamplingOrder)
+    {
+        coefficients.oversamplingOrder = chainSettings.oversamplingOrder;
+        bandsToDesign = ChainBands::AllBands;
+    }
+    auto designRate = getOversampledRate(sampleRate, coefficients.oversamplingOrder);
+
+    //butterworth order is (slope + 1) * 2, giving slope + 1 biquad sections
     //slope is 0,1,2,3 (representing 12, 24, 36, 48)
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-    auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+    if (bandsToDesign & ChainBands::LowCutBand)
+    {
+        coefficients.lowCut = makeLowCutFilter<double>(chainSettings, designRate, cutTable);
+        coefficients.lowCutSlope = chainSettings.lowCutSlope;
+        //a cut at the end of its range does nothing audible, so it doesn't run either
+        coefficients.lowCutBypassed = chainSettings.lowCutBypassed || chainSettings.lowCutFreq <= minimumFrequency;
+        ++coefficients.bandVersions[ChainPositions::LowCut];
+    }
+
+    if (bandsToDesign & ChainBands::PeakBand)
+    {
+        coefficients.peakPrototype = designPeakPrototype(designRate, chainSettings.peakFreq, chainSettings.peakQuality);
+        coefficients.peakGainInDecibels = chainSettings.peakGainInDecibels;
+        coefficients.peak = coefficients.peakPrototype.withGain<double>(juce::Decibels::decibelsToGain((double)chainSettings.peakGainInDecibels));
+        coefficients.peakDetector = designBandPass<double>(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality);
+        coefficients.peakBypassed = chainSettings.peakBypassed || (chainSettings.peakGainInDecibels == 0.f && !chainSettings.peakDynamic);
+        ++coefficients.bandVersions[ChainPositions::Peak];
+    }
 
+    if (bandsToDesign & ChainBands::HighCutBand)
+    {
+        coefficients.highCut = makeHighCutFilter<double>(chainSettings, designRate, cutTable);
+        coefficients.highCutSlope = chainSettings.highCutSlope;
+        coefficients.highCutBypassed = chainSettings.highCutBypassed || chainSettings.highCutFreq >= maximumFrequency;
+        ++coefficients.bandVersions[ChainPositions::HighCut];
+    }
 
-    leftChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    leftChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
-    rightChain.setBypassed<ChainPositions::LowCut>(chainSettings.lowCutBypassed);
-    rightChain.setBypassed<ChainPositions::HighCut>(chainSettings.highCutBypassed);
+    for (int i = 0; i < maxExtraBands; ++i)
+    {
+        if ((bandsToDesign & getExtraBandBit(i)) == 0)
+            continue;
+
+        //off bands keep whatever coefficients they had, they just stop running
+        //(so do gain type bands sitting at 0dB, they're unity anyway)
+        auto& band = chainSettings.extraBands[(size_t)i];
+        auto isFlat = band.gainInDecibels == 0.f
+            && (band.type == BandType::BandPeak || band.type == BandType::BandLowShelf || band.type == BandType::BandHighShelf);
+        coefficients.extraBandActive[(size_t)i] = band.type != BandType::BandOff && !isFlat;
+        if (band.type != BandType::BandOff)
+            coefficients.extraBands[(size_t)i] = designBand<double>(band.type, designRate, band.freq, band.quality,
+                                                                    juce::Decibels::decibelsToGain((double)band.gainInDecibels));
+        ++coefficients.bandVersions[ChainPositions::FirstExtraBand + (size_t)i];
+    }
+}
 
-    updateCutFilter(leftLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(rightLowCut, lowCutCoefficients, chainSettings.lowCutSlope);
 
+int RomalEQAudioProcessor::takeChangedBands(const ChainCoefficients& chainCoefficients, std::array<juce::uint32, numChainBands>& appliedVersions) {
 
+    //only touch the bands the designer actually changed since the last set we applied
+    int changedBands = 0;
+    for (size_t i = 0; i < appliedVersions.size(); ++i)
+    {
+        if (chainCoefficients.bandVersions[i] != appliedVersions[i])
+        {
+            appliedVersions[i] = chainCoefficients.bandVersions[i];
+            changedBands |= 1 << i;
+        }
+    }
+    return changedBands;
+}
 
+void RomalEQAudioProcessor::updateFilters(const ChainCoefficients& chainCoefficients) {
+    applyToChains(chainCoefficients, takeChangedBands(chainCoefficients, appliedBandVersions));
+}
 
+void RomalEQAudioProcessor::updateSideFilters(const ChainCoefficients& sideCoefficients) {
+    //in L/R mode the side chain runs the main set, switching to mid/side applies the whole side set anyway
+    if (midSideActive)
+        applySideToChains(sideCoefficients, takeChangedBands(sideCoefficients, appliedSideBandVersions));
 }
-void RomalEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings) {
 
-    //butterworthmethod args
-    //frequency, samplerate, order
-    // order returns order/2 sets of coefficients
-    //slope is 0,1,2,3 (representing 12, 24, 36, 48)
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-    auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-    auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-    updateCutFilter(leftHighCut, highCutCoefficients, chainSettings.highCutSlope);
-    updateCutFilter(rightHighCut, highCutCoefficients, chainSettings.highCutSlope);
+void RomalEQAudioProcessor::applyToChains(const ChainCoefficients& chainCoefficients, int bandsToApply) {
+    forActiveChains([&](auto& chains) { chains.applyCoefficients(chainCoefficients, bandsToApply, midSideActive); });
+}
 
+void RomalEQAudioProcessor::applySideToChains(const ChainCoefficients& sideCoefficients, int bandsToApply) {
+    forActiveChains([&](auto& chains) { chains.applySideCoefficients(sideCoefficients, bandsToApply); });
 }
 
-void RomalEQAudioProcessor::updateFilters() {
-    auto chainSettings = getChainSettings(apvts);
+void RomalEQAudioProcessor::applyPeakToChains(const BiquadCoefficients<double>& peak) {
+    forActiveChains([&](auto& chains) { chains.applyPeak(peak, midSideActive); });
+}
+
+
+ChainSettingsTracker::CoreBandParameters::CoreBandParameters(juce::AudioProcessorValueTreeState& state, const juce::String& prefix) :
+    lowCutFreq(state.getRawParameterValue(prefix + "LowCut Freq")),
+    highCutFreq(state.getRawParameterValue(prefix + "HighCut Freq")),
+    peakFreq(state.getRawParameterValue(prefix + "Peak Freq")),
+    peakGain(state.getRawParameterValue(prefix + "Peak Gain")),
+    peakQuality(state.getRawParameterValue(prefix + "Peak Quality")),
+    lowCutSlope(state.getRawParameterValue(prefix + "LowCut Slope")),
+    highCutSlope(state.getRawParameterValue(prefix + "HighCut Slope")),
+    lowCutBypassed(state.getRawParameterValue(prefix + "LowCut Bypassed")),
+    highCutBypassed(state.getRawParameterValue(prefix + "HighCut Bypassed")),
+    peakBypassed(state.getRawParameterValue(prefix + "Peak Bypassed")),
+    peakDynamic(prefix.isEmpty() ? state.getRawParameterValue("Peak Dynamic") : nullptr)
+{
+}
 
-    updateLowCutFilters(chainSettings);
-    updateHighCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
+void ChainSettingsTracker::CoreBandParameters::read(ChainSettings& settings) const
+{
+    settings.lowCutFreq = lowCutFreq->load();
+    settings.highCutFreq = highCutFreq->load();
+    settings.peakFreq = peakFreq->load();
+    settings.peakGainInDecibels = peakGain->load();
+    settings.peakQuality = peakQuality->load();
+    settings.lowCutSlope = static_cast<Slope>(lowCutSlope->load());
+    settings.highCutSlope = static_cast<Slope>(highCutSlope->load());
+
+    settings.lowCutBypassed = lowCutBypassed->load() > 0.5;
+    settings.highCutBypassed = highCutBypassed->load() > 0.5;
+    settings.peakBypassed = peakBypassed->load() > 0.5;
+    settings.peakDynamic = peakDynamic != nullptr && peakDynamic->load() > 0.5;
+}
+
+ChainSettingsTracker::ChainSettingsTracker(juce::AudioProcessorValueTreeState& state) : apvts(state),
+    mainBands(state, {}),
+    sideBands(state, "Side "),
+    oversampling(state.getRawParameterValue("Oversampling"))
+{
+    for (int i = 0; i < maxExtraBands; ++i)
+    {
+        extraBands[(size_t)i] = { state.getRawParameterValue(getExtraBandParameterID(i, "Type")),
+                                  state.getRawParameterValue(getExtraBandParameterID(i, "Freq")),
+                                  state.getRawParameterValue(getExtraBandParameterID(i, "Gain")),
+                                  state.getRawParameterValue(getExtraBandParameterID(i, "Quality")) };
+    }
 
-}
\ No newline at end of file
+    for (auto* param : apvts.processor.getParameters())
+    {
+        if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*>(param))
+            apvts.addParameterListener(rangedParam->paramID, this);
+    }
+}
+
+ChainSettingsTracker::~ChainSettingsTracker()
+{
+    for (auto* param : apvts.processor.getParameters())
+    {
+        if (auto* rangedParam = dynamic_cast<juce::RangedAudioParameter*>(param))
+            apvts.removeParameterListener(rangedParam->paramID, this);
+    }
+}
+
+int ChainSettingsTracker::getBandsForParameter(const juce::String& parameterID)
+{
+    if (parameterID.startsWith("Side LowCut"))
+        return ChainBands::SideLowCutBand;
+    if (parameterID.startsWith("Side Peak"))
+        return ChainBands::SidePeakBand;
+    if (parameterID.startsWith("Side HighCut"))
+        return ChainBands::SideHighCutBand;
+    if (parameterID.startsWith("LowCut"))
+        return ChainBands::LowCutBand;
+    //the dynamics detector settings are read straight from the apvts every block, the peak's design doesn't change
+    if (parameterID == "Peak Threshold" || parameterID == "Peak Ratio" || parameterID == "Peak Attack" || parameterID == "Peak Release")
+        return 0;
+    if (parameterID.startsWith("Peak"))
+        return ChainBands::PeakBand;
+    if (parameterID.startsWith("HighCut"))
+        return ChainBands::HighCutBand;
+    if (parameterID.startsWith("Band "))
+    {
+        //"Band <n> ..."
+        auto extraBandIndex = parameterID.substring(5).getIntValue() - 1;
+        return juce::isPositiveAndBelow(extraBandIndex, maxExtraBands) ? getExtraBandBit(extraBandIndex) : 0;
+    }
+    //a new oversampling order moves every band's design rate, and switching to linear phase needs a fresh kernel
+    if (parameterID == "Oversampling" || parameterID == "Phase Mode")
+        return ChainBands::AllBands;
+    return 0;
+}
+
+void ChainSettingsTracker::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    //can be called from any thread (host automation arrives on the audio thread), so only bump a counter here
+    juce::ignoreUnused(newValue);
+    auto bands = getBandsForParameter(parameterID);
+    if (bands != 0)
+    {
+        for (size_t i = 0; i < versions.size(); ++i)
+            if (bands & (1 << i))
+                versions[i].fetch_add(1, std::memory_order_release);
+
+        if (onBandChanged)
+            onBandChanged();
+    }
+}
+
+void ChainSettingsTracker::markAllDirty()
+{
+    for (auto& version : versions)
+        version.fetch_add(1, std::memory_order_release);
+}
+
+int ChainSettingsTracker::pullChanges(ChainSettings& settings, ChainSettings& sideSettings)
+{
+    int changedBands = 0;
+    for (size_t i = 0; i < versions.size(); ++i)
+    {
+        auto version = versions[i].load(std::memory_order_acquire);
+        if (version != seenVersions[i])
+        {
+            seenVersions[i] = version;
+            changedBands |= 1 << i;
+        }
+    }
+
+    //a handful of atomic loads, only paid when something actually moved
+    if (changedBands != 0)
+    {
+        settings = getCurrentSettings();
+        sideSettings = settings;
+        sideBands.read(sideSettings);
+    }
+
+    return changedBands;
+}
+
+ChainSettings ChainSettingsTracker::getCurrentSettings() const
+{
+    ChainSettings settings;
+    mainBands.read(settings);
+    settings.oversamplingOrder = (int)oversampling->load();
+
+    for (size_t i = 0; i < extraBands.size(); ++i)
+    {
+        auto& band = settings.extraBands[i];
+        band.type = static_cast<BandType>(extraBands[i].type->load());
+        band.freq = extraBands[i].freq->load();
+        band.gainInDecibels = extraBands[i].gain->load();
+        band.quality = extraBands[i].quality->load();
+    }
+    return settings;
+}
+
+ChainSettings ChainSettingsTracker::getCurrentSideSettings() const
+{
+    auto settings = getCurrentSettings();
+    sideBands.read(settings);
+    return settings;
+}
+
+
+CoefficientDesigner::CoefficientDesigner(ChainSettingsTracker& t) : juce::Thread("RomalEQ Coefficient Designer"), tracker(t)
+{
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    stopThread(1000);
+}
+
+void CoefficientDesigner::prepare(double newSampleRate, int maxOversamplingOrder)
+{
+    //the worker is the only consumer of the tracker, so park it while we design synchronously
+    stopThread(1000);
+    sampleRate = newSampleRate;
+    cutTable.prepare(sampleRate, maxOversamplingOrder);
+
+    tracker.markAllDirty();
+    ChainSettings chainSettings, sideSettings;
+    designAndPublish(chainSettings, sideSettings, tracker.pullChanges(chainSettings, sideSettings));
+
+    startThread();
+}
+
+void CoefficientDesigner::release()
+{
+    stopThread(1000);
+}
+
+void CoefficientDesigner::run()
+{
+    while (!threadShouldExit())
+    {
+        ChainSettings chainSettings, sideSettings;
+        if (auto changedBands = tracker.pullChanges(chainSettings, sideSettings))
+            designAndPublish(chainSettings, sideSettings, changedBands);
+
+        wait(pollIntervalMs);
+    }
+}
+
+void CoefficientDesigner::designAndPublish(const ChainSettings& chainSettings, const ChainSettings& sideSettings, int bandsToDesign)
+{
+    designChainCoefficients(chainSettings, sampleRate, bandsToDesign, designed.main, &cutTable);
+
+    //the side set shares the extra bands (and oversampling) with the main one, its own bits cover the rest
+    auto sideBandsToDesign = getSideBandsAsMainBands(bandsToDesign) | (bandsToDesign & ChainBands::ExtraBands);
+    if (sideBandsToDesign != 0 || sideSettings.oversamplingOrder != designed.side.oversamplingOrder)
+        designChainCoefficients(sideSettings, sampleRate, sideBandsToDesign, designed.side, &cutTable);
+
+    designed.settingsVersions = tracker.getSeenVersions();
+
+    //worked out from the poles here rather than on the audio thread, a few logs per band
+    designed.tailSeconds = juce::jmax(getChainDecaySeconds(designed.main, tailLevel, sampleRate),
+                                      getChainDecaySeconds(designed.side, tailLevel, sampleRate));
+    designed.silenceSeconds = juce::jmax(getChainDecaySeconds(designed.main, silenceLevel, sampleRate),
+                                         getChainDecaySeconds(designed.side, silenceLevel, sampleRate));
+
+    //publish both sets, band versions tell the audio thread which parts are new
+    mailbox.getWriteBuffer() = designed;
+    mailbox.publish();
+
+    if (onSetDesigned)
+        onSetDesigned(designed.main);
+}
@@ -10,6 +10,13 @@
 
 #include <JuceHeader.h>
 #include <array>
+#include "ChainCoefficients.h"
+#include "VectorChain.h"
+#include "LatestValue.h"
+#include "LinearPhaseEngine.h"
+#include "PeakDynamics.h"
+#include "CutFilterTable.h"
+#include "SampleRing.h"
 enum Channel {
     Right, // represented as 0
     Left // represented as 1
@@ -20,21 +27,6 @@ enum Channel {
 template<typename T>
 struct Fifo
 {
-    void prepare(int numChannels, int numSamples)
-    {
-        static_assert(std::is_same_v<T, juce::AudioBuffer<float>>,
-            "prepare(numChannels, numSamples) should only be used when the Fifo is holding juce::AudioBuffer<float>");
-        for (auto& buffer : buffers)
-        {
-            buffer.setSize(numChannels,
-                numSamples,
-                false,   //clear everything?
-                true,    //including the extra space?
-                true);   //avoid reallocating if you can?
-            buffer.clear();
-        }
-    }
-
     void prepare(size_t numElements)
     {
         static_assert(std::is_same_v<T, std::vector<float>>,
@@ -82,77 +74,83 @@ private:
 
 
 //FFT uses fixed number of samples, host is sending mixed size audio samples
-//single channel sample fifo does this
-template<typename BlockType>
+//single channel sample fifo does this: the audio thread writes whatever it gets into a ring,
+//the analyzer reads it back straight out of the ring, on whatever thread it runs on
 struct SingleChannelSampleFifo
 {
     SingleChannelSampleFifo(Channel ch) : channelToUse(ch)
     {
         prepared.set(false);
+        //allocated once, here: the reader may be on another thread while prepareToPlay runs
+        ring.prepare(capacity);
     }
 
-    void update(const BlockType& buffer)
+    //double precision buffers get narrowed to float on the way in, the analyzer doesn't need more
+    template<typename SampleType>
+    void update(const juce::AudioBuffer<SampleType>& buffer)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse);
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
-
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            pushNextSampleIntoFifo(channelPtr[i]);
-        }
+        //mono buses only have channel 0, so both analyzer taps read that
+        auto channel = juce::jmin((int)channelToUse, buffer.getNumChannels() - 1);
+        auto written = ring.write(buffer.getReadPointer(channel), buffer.getNumSamples());
+        juce::ignoreUnused(written);
     }
 
+    //doesn't touch the ring, whatever is still in there (maybe at the old sample rate) gets dropped by the reader
     void prepare(int bufferSize)
     {
-        prepared.set(false);
         size.set(bufferSize);
-
-        bufferToFill.setSize(1,             //channel
-            bufferSize,    //num samples
-            false,         //keepExistingContent
-            true,          //clear extra space
-            true);         //avoid reallocating
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex = 0;
+        discardPending();
         prepared.set(true);
     }
     //==============================================================================
-    int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
+    //any thread: the reader drops everything written so far the next time it calls skipDiscarded()
+    void discardPending() { discardGeneration.fetch_add(1); }
+    //==============================================================================
+    //reader only, everything below
+    int getNumSamplesAvailable() const { return ring.getNumReady(); }
     bool isPrepared() const { return prepared.get(); }
     int getSize() const { return size.get(); }
-    //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
-private:
-    Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
-    juce::Atomic<bool> prepared = false;
-    juce::Atomic<int> size = 0;
-
-    void pushNextSampleIntoFifo(float sample)
+    //call before reading, skips what discardPending() asked to drop (the read position is the reader's to move)
+    void skipDiscarded()
     {
-        if (fifoIndex == bufferToFill.getNumSamples())
+        auto generation = discardGeneration.load();
+        if (generation != readerGeneration)
         {
-            auto ok = audioBufferFifo.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-
-            fifoIndex = 0;
+            readerGeneration = generation;
+            releaseSamples(getNumSamplesAvailable());
         }
-
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
     }
+    //the oldest numSamples, in place (two spans if it wraps), until releaseSamples()
+    SampleRing::ReadView getSamples(int numSamples) const { return ring.getReadView(numSamples); }
+    //also how the reader skips samples it has no use for
+    void releaseSamples(int numSamples)
+    {
+        ring.finishedReading(numSamples);
+        readPosition += numSamples;
+    }
+    //samples read (or skipped) since construction, both channels get written the same blocks
+    //so equal read positions mean the two readers sit on the same sample
+    juce::int64 getReadPosition() const { return readPosition; }
+private:
+    Channel channelToUse;
+    //room for several of the biggest analyzer windows at any host block size, about 2.7s at 48kHz
+    //a full ring just drops what doesn't fit until the reader catches up
+    static constexpr int capacity = 1 << 17;
+    SampleRing ring;
+    juce::Atomic<bool> prepared = false;
+    juce::Atomic<int> size = 0;
+    std::atomic<int> discardGeneration{ 0 };
+    int readerGeneration = 0;
+    juce::int64 readPosition = 0;
 };
 
 
-enum Slope {
-    Slope_12,
-    Slope_24,
-    Slope_36,
-    Slope_48
+//one extra band's parameters
+struct BandSettings
+{
+    BandType type{ BandType::BandOff };
+    float freq{ 1000.f }, gainInDecibels{ 0 }, quality{ 1.f };
 };
 
 //data structure representing apvts parameter values
@@ -162,34 +160,341 @@ struct ChainSettings
     float lowCutFreq{ 0 }, highCutFreq{ 0 };
     Slope lowCutSlope{ Slope::Slope_12 }, highCutSlope{ Slope::Slope_12 };
     bool lowCutBypassed{ false }, peakBypassed{ false }, highCutBypassed{ false };
+    //a dynamic peak can move away from 0dB, so it never counts as flat (main chain only)
+    bool peakDynamic{ false };
+    //0 = off, 1 = 2x, 2 = 4x
+    int oversamplingOrder{ 0 };
+    std::array<BandSettings, maxExtraBands> extraBands;
+
+};
+
+//the side chain of mid/side mode is read with coreBandPrefix "Side ": its own lowcut, peak and highcut
+//("Side LowCut Freq" etc), everything else (extra bands, oversampling) is shared with the main chain
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts, const juce::String& coreBandPrefix = {});
+
+//extra band parameters are "Band <n> <name>", n counting from 1, e.g. "Band 3 Freq"
+juce::String getExtraBandParameterID(int extraBandIndex, const juce::String& name);
+
+//ramps the continuous ChainSettings values (frequencies, gain, Q) towards their targets
+//discrete values (slopes, bypass) jump straight to the target
+struct ChainSettingsSmoother
+{
+    void reset(double sampleRate, double rampLengthSeconds);
+    void setCurrentAndTarget(const ChainSettings& settings);
+    void setTarget(const ChainSettings& settings);
+
+    bool isSmoothing() const;
+
+    //moves every ramp forward by numSamples, getCurrent() then holds the settings for that stretch
+    void advance(int numSamples);
+    const ChainSettings& getCurrent() const { return current; }
+
+    //ChainBands mask of the bands whose settings moved since the last call (ramps and discrete jumps alike)
+    //so only those need re-deriving from getCurrent()
+    int takeBandsToDesign();
+    //for when whoever holds the derived set lets it go stale
+    void markBandsToDesign(int bands) { bandsToDesign |= bands; }
+
+private:
+    //frequencies and Q ramp in ratios, so a sweep moves at a constant speed on the log scale
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> lowCutFreq, highCutFreq, peakFreq, peakQuality;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> peakGain;
+    std::array<juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>, maxExtraBands> bandFreq, bandQuality;
+    std::array<juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear>, maxExtraBands> bandGain;
+    ChainSettings current;
+    int bandsToDesign = ChainBands::AllBands;
+};
+
+//ramps bands in and out when they switch on or off, instead of a hard bypass
+//a fading band keeps running at a wet level (see withWetLevel), so at 0 it's exactly unity and its poles never move
+struct BandFader
+{
+    void reset(double sampleRate, double fadeLengthSeconds);
+
+    //jumps straight to the set's on / off states, no fades
+    void snapTo(const ChainCoefficients& coefficients);
+
+    //starts a fade for every band whose on / off state differs from the set's
+    //returns a ChainBands mask of the bands fading in from fully off, their filter state wants clearing first
+    int setTarget(const ChainCoefficients& coefficients);
 
+    bool isFading() const { return fadingBands != 0; }
+
+    //moves every fade on by numSamples, returns a ChainBands mask of the bands that were fading
+    //(the ones that just finished included, they need their real coefficients back)
+    int advance(int numSamples);
+
+    //copies source into faded with the fades applied: bands still fading run at their current level,
+    //bands that finished fading out are off (a ramping source can still have them on)
+    void applyFades(const ChainCoefficients& source, ChainCoefficients& faded) const;
+
+    float getLevel(int position) const { return levels[(size_t)position].getCurrentValue(); }
+
+private:
+    std::array<juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear>, numSetBands> levels;
+    int fadingBands = 0;
 };
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts );
+//once the input has been silent for as long as everything running takes to ring out (below the denormal threshold),
+//filtering can stop until a non-silent block arrives
+//update() looks at the input before the block runs, advance() counts the block once it has run
+struct SilenceDetector
+{
+    void reset()
+    {
+        silentSamples = 0;
+        requiredSilentSamples = 0;
+        sleeping = false;
+        inputWasSilent = false;
+    }
+
+    //returns true if the block can be skipped, a non-silent one wakes everything up
+    template<typename SampleType>
+    bool update(const juce::AudioBuffer<SampleType>& buffer, int numInputChannels)
+    {
+        //anything below the smallest normal float is flushed to zero by the filters anyway
+        auto numSamples = buffer.getNumSamples();
+        numInputChannels = juce::jmin(buffer.getNumChannels(), numInputChannels);
+        inputWasSilent = true;
+        for (int ch = 0; ch < numInputChannels && inputWasSilent; ++ch)
+            inputWasSilent = buffer.getMagnitude(ch, 0, numSamples) < static_cast<SampleType>(std::numeric_limits<float>::min());
+
+        if (!inputWasSilent)
+            reset();
+
+        return sleeping;
+    }
+
+    //samplesToRingOut: how long whatever ran this block takes to die away
+    //returns true when it goes to sleep, that's when the caller clears the state (which by then changes nothing)
+    bool advance(int numSamples, int samplesToRingOut)
+    {
+        if (!inputWasSilent || sleeping)
+            return false;
+
+        //capped below requiredSilentSamples' ceiling, so a set that never rings out never sleeps
+        silentSamples = (int)juce::jmin((juce::int64)silentSamples + numSamples, (juce::int64)std::numeric_limits<int>::max() / 2);
+
+        //settings can change during the silence (this block included), so the longest ring since it started decides
+        requiredSilentSamples = juce::jmax(requiredSilentSamples, samplesToRingOut);
+        sleeping = silentSamples >= requiredSilentSamples;
+        return sleeping;
+    }
+
+private:
+    int silentSamples = 0, requiredSilentSamples = 0;
+    bool sleeping = false, inputWasSilent = false;
+};
+
+//hands parameter values from the audio thread to the message thread, which sets them
+//(setValueNotifyingHost calls the host and every listener straight away, so it stays off the audio thread)
+//counts per band say when everything queued for a band has been set, and the tracker version that left it on
+struct ParameterValueQueue
+{
+    //audio thread, returns false if the queue was full and the value got dropped
+    bool push(int mapping, float value, int position)
+    {
+        const auto scope = fifo.write(1);
+        if (scope.blockSize1 + scope.blockSize2 == 0)
+            return false;
+
+        values[(size_t)(scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = { mapping, value, position };
+        ++queuedCounts[(size_t)position];
+        return true;
+    }
+
+    //message thread, setValue(mapping, value) sets the parameter and returns the band's tracker version after it
+    template<typename Function>
+    void drain(Function&& setValue)
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+        auto drainRange = [&](int start, int size)
+        {
+            for (auto index = start; index < start + size; ++index)
+            {
+                const auto& queued = values[(size_t)index];
+                auto position = (size_t)queued.position;
+                setVersions[position].store(setValue(queued.mapping, queued.value), std::memory_order_relaxed);
+                setCounts[position].fetch_add(1, std::memory_order_release);
+            }
+        };
+        drainRange(scope.startIndex1, scope.blockSize1);
+        drainRange(scope.startIndex2, scope.blockSize2);
+    }
+
+    //audio thread: has every value queued for the band been set, and the version the last one left it on
+    bool isBandSet(int position) const { return setCounts[(size_t)position].load(std::memory_order_acquire) == queuedCounts[(size_t)position]; }
+    juce::uint32 getSetVersion(int position) const { return setVersions[(size_t)position].load(std::memory_order_relaxed); }
+
+private:
+    struct QueuedValue
+    {
+        int mapping;
+        float value;
+        int position;
+    };
+    static constexpr int size = 64;
+    juce::AbstractFifo fifo{ size };
+    std::array<QueuedValue, size> values;
+    std::array<juce::uint32, numChainBands> queuedCounts{};
+    std::array<std::atomic<juce::uint32>, numChainBands> setCounts{}, setVersions{};
+};
 
 //create type aliases to simplify definitions
-using Filter = juce::dsp::IIR::Filter<float>;
+//the chains come in float and double, double keeps low cutoffs at high sample rates clean
+template<typename SampleType>
+using Filter = juce::dsp::IIR::Filter<SampleType>;
 
 //important JUCE dsp concept, define a processing chain and then pass in a processing context
-//4 filters in a CutFilter because TODO ??????????
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
+//4 filters in a CutFilter: the steepest slope, 48 dB/oct, is an 8th order butterworth, which is 4 second order sections
+template<typename SampleType>
+using CutFilter = juce::dsp::ProcessorChain<Filter<SampleType>, Filter<SampleType>, Filter<SampleType>, Filter<SampleType>>;
 //mono chain: lowcut -> parametric band -> highcut
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
-//two monochains needed for stereo 
-
-//define chain Positions
-enum ChainPositions {
-    LowCut,
-    Peak,
-    HighCut
+template<typename SampleType>
+using MonoChain = juce::dsp::ProcessorChain<CutFilter<SampleType>, Filter<SampleType>, CutFilter<SampleType>>;
+//one monochain needed per channel
+
+template<typename SampleType>
+using Coefficients = juce::ReferenceCountedObjectPtr<juce::dsp::IIR::Coefficients<SampleType>>;
+
+//writes straight into the existing coefficient storage, so this never allocates
+//old has to already hold a biquad, see prepareForInPlaceUpdates()
+template<typename SampleType>
+void updateCoefficients(Coefficients<SampleType>& old, const BiquadCoefficients<double>& replacements) {
+    //the old *old = *replacements copied a juce::Array, which can allocate
+    jassert(old->getFilterOrder() == 2);
+    auto* raw = old->getRawCoefficients();
+    raw[0] = static_cast<SampleType>(replacements.b0);
+    raw[1] = static_cast<SampleType>(replacements.b1);
+    raw[2] = static_cast<SampleType>(replacements.b2);
+    raw[3] = static_cast<SampleType>(replacements.a1);
+    raw[4] = static_cast<SampleType>(replacements.a2);
+}
+
+//the extra bands of one channel for the MonoChain engine: a runtime list of juce IIR filters
+//only the bands that are switched on get processed, in band order
+template<typename SampleType>
+struct ExtraBandChain
+{
+    //gives every filter its own biquad coefficient object, allocates
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        for (auto& filter : filters)
+        {
+            filter.coefficients = new juce::dsp::IIR::Coefficients<SampleType>(1, 0, 0, 1, 0, 0);
+            filter.prepare(spec);
+        }
+        numActiveBands = 0;
+    }
+
+    void reset()
+    {
+        for (auto& filter : filters)
+            filter.reset();
+    }
+
+    //clears the state of the given extra bands (ChainBands mask)
+    void resetBands(int bands)
+    {
+        for (int i = 0; i < maxExtraBands; ++i)
+            if (bands & getExtraBandBit(i))
+                filters[(size_t)i].reset();
+    }
+
+    //allocation free
+    void setCoefficients(const ChainCoefficients& coefficients, int bandsToApply)
+    {
+        for (int i = 0; i < maxExtraBands; ++i)
+            if (bandsToApply & getExtraBandBit(i))
+                updateCoefficients(filters[(size_t)i].coefficients, coefficients.extraBands[(size_t)i]);
+
+        numActiveBands = 0;
+        for (int i = 0; i < maxExtraBands; ++i)
+            if (coefficients.extraBandActive[(size_t)i])
+                activeBands[(size_t)numActiveBands++] = i;
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context)
+    {
+        for (int i = 0; i < numActiveBands; ++i)
+            filters[(size_t)activeBands[(size_t)i]].process(context);
+    }
+
+private:
+    std::array<Filter<SampleType>, maxExtraBands> filters;
+    std::array<int, maxExtraBands> activeBands{};
+    int numActiveBands = 0;
 };
 
+//versioned view of the apvts
+//every parameter change bumps the version of the band it belongs to, the designer thread compares
+//those against the versions it saw last time, so it only redesigns bands that actually changed
+struct ChainSettingsTracker : juce::AudioProcessorValueTreeState::Listener
+{
+    ChainSettingsTracker(juce::AudioProcessorValueTreeState& apvts);
+    ~ChainSettingsTracker() override;
 
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
 
-using Coefficients = Filter::CoefficientsPtr;
-void updateCoefficients(Coefficients& old, const Coefficients& replacements);
+    //next pullChanges() reports every band (prepareToPlay, state restore)
+    void markAllDirty();
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate);
+    //returns a ChainBands mask of what changed since the last call
+    //both settings are only refreshed when the mask is non zero, no allocation either way
+    int pullChanges(ChainSettings& settings, ChainSettings& sideSettings);
+
+    //same as getChainSettings(apvts) but through cached parameter pointers, so no string lookups
+    ChainSettings getCurrentSettings() const;
+    //same as getChainSettings(apvts, "Side ")
+    ChainSettings getCurrentSideSettings() const;
+
+    //called after a band version moved, on whatever thread changed the parameter
+    std::function<void()> onBandChanged;
+
+    //any thread: how many times the band at position has changed
+    juce::uint32 getVersion(int position) const { return versions[(size_t)position].load(std::memory_order_acquire); }
+    //the versions the last pullChanges() saw, only for whoever calls that
+    const std::array<juce::uint32, numChainBands>& getSeenVersions() const { return seenVersions; }
+
+private:
+    juce::AudioProcessorValueTreeState& apvts;
+    std::array<std::atomic<juce::uint32>, numChainBands> versions{};
+    std::array<juce::uint32, numChainBands> seenVersions{};
+
+    //lowcut, peak and highcut, once for the main chain and once for the side chain
+    struct CoreBandParameters
+    {
+        CoreBandParameters(juce::AudioProcessorValueTreeState& apvts, const juce::String& prefix);
+        void read(ChainSettings& settings) const;
+
+        std::atomic<float>* lowCutFreq, * highCutFreq, * peakFreq, * peakGain, * peakQuality;
+        std::atomic<float>* lowCutSlope, * highCutSlope, * lowCutBypassed, * highCutBypassed, * peakBypassed;
+        //only the main chain's peak can be dynamic, nullptr for the side chain
+        std::atomic<float>* peakDynamic;
+    };
+    CoreBandParameters mainBands, sideBands;
+    std::atomic<float>* oversampling;
+
+    struct ExtraBandParameters
+    {
+        std::atomic<float>* type, * freq, * gain, * quality;
+    };
+    std::array<ExtraBandParameters, maxExtraBands> extraBands;
+
+    //ChainBands mask of what a parameter affects, 0 for params that don't touch the chain
+    //band parameter IDs are prefixed with their band name ("Band <n>" for the extra bands, "Side ..." for the side chain),
+    //oversampling and phase mode changes redesign every band
+    static int getBandsForParameter(const juce::String& parameterID);
+};
+
+
+
+template<typename SampleType>
+BiquadCoefficients<SampleType> makePeakFilter(const ChainSettings& chainSettings, double sampleRate) {
+
+    return designPeak<SampleType>(sampleRate, chainSettings.peakFreq, chainSettings.peakQuality,
+        juce::Decibels::decibelsToGain((double)chainSettings.peakGainInDecibels));
+}
 
 
 
@@ -227,16 +532,380 @@ void updateCutFilter(ChainType& chain, const CoefficientType& coefficients, cons
     }
 }
 
-inline auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate) {
-    return  juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq,
-       sampleRate, (chainSettings.lowCutSlope + 1) * 2);
+//butterworth with order (slope + 1) * 2, only the first (slope + 1) sections are filled in
+//closed form instead of FilterDesign, so no allocation and fine to call per smoothing sub-block
+//with a cut table the sections come from it, otherwise they're designed on the spot
+template<typename SampleType>
+auto makeLowCutFilter(const ChainSettings& chainSettings, double sampleRate, const CutFilterTable* cutTable = nullptr) {
+    std::array<BiquadCoefficients<SampleType>, ChainCoefficients::maxCutStages> sections;
+    if (cutTable != nullptr)
+        cutTable->lookup(sampleRate, chainSettings.lowCutFreq, chainSettings.lowCutSlope, true, sections);
+    else
+        designButterworthCut(sampleRate, chainSettings.lowCutFreq, chainSettings.lowCutSlope, true, sections);
+    return sections;
 }
 
-inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate) {
-    return  juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq,
-        sampleRate, (chainSettings.highCutSlope + 1) * 2);
+template<typename SampleType>
+auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleRate, const CutFilterTable* cutTable = nullptr) {
+    std::array<BiquadCoefficients<SampleType>, ChainCoefficients::maxCutStages> sections;
+    if (cutTable != nullptr)
+        cutTable->lookup(sampleRate, chainSettings.highCutFreq, chainSettings.highCutSlope, false, sections);
+    else
+        designButterworthCut(sampleRate, chainSettings.highCutFreq, chainSettings.highCutSlope, false, sections);
+    return sections;
 }
 
+//gives every filter in the chain its own biquad sized coefficient object so later updates can happen in place
+//allocates, so call it from prepareToPlay / the editor, never from the audio thread
+template<typename SampleType>
+void prepareForInPlaceUpdates(MonoChain<SampleType>& chain) {
+
+    auto makeBiquad = [](Filter<SampleType>& filter)
+    {
+        //unity biquad: b0, b1, b2, a0, a1, a2
+        filter.coefficients = new juce::dsp::IIR::Coefficients<SampleType>(1, 0, 0, 1, 0, 0);
+    };
+
+    auto prepareCutFilter = [&makeBiquad](CutFilter<SampleType>& cutFilter)
+    {
+        makeBiquad(cutFilter.template get<0>());
+        makeBiquad(cutFilter.template get<1>());
+        makeBiquad(cutFilter.template get<2>());
+        makeBiquad(cutFilter.template get<3>());
+    };
+
+    prepareCutFilter(chain.template get<ChainPositions::LowCut>());
+    makeBiquad(chain.template get<ChainPositions::Peak>());
+    prepareCutFilter(chain.template get<ChainPositions::HighCut>());
+}
+
+//designs the requested bands (ChainBands mask) and bumps their versions
+//allocation free, but normally run on the designer thread so the audio thread doesn't pay for the trig
+//the cuts come from cutTable when there is one (see CutFilterTable)
+void designChainCoefficients(const ChainSettings& chainSettings, double sampleRate, int bandsToDesign, ChainCoefficients& coefficients,
+                             const CutFilterTable* cutTable = nullptr);
+
+//copies the requested bands of a designed set into a chain, allocation free
+template<typename SampleType>
+void applyChainCoefficients(MonoChain<SampleType>& chain, const ChainCoefficients& coefficients, int bandsToApply) {
+
+    if (bandsToApply & ChainBands::LowCutBand)
+    {
+        chain.template setBypassed<ChainPositions::LowCut>(coefficients.lowCutBypassed);
+        updateCutFilter(chain.template get<ChainPositions::LowCut>(), coefficients.lowCut, coefficients.lowCutSlope);
+    }
+
+    if (bandsToApply & ChainBands::PeakBand)
+    {
+        chain.template setBypassed<ChainPositions::Peak>(coefficients.peakBypassed);
+        updateCoefficients(chain.template get<ChainPositions::Peak>().coefficients, coefficients.peak);
+    }
+
+    if (bandsToApply & ChainBands::HighCutBand)
+    {
+        chain.template setBypassed<ChainPositions::HighCut>(coefficients.highCutBypassed);
+        updateCutFilter(chain.template get<ChainPositions::HighCut>(), coefficients.highCut, coefficients.highCutSlope);
+    }
+}
+
+//L/R <-> M/S on channels 0 and 1 of a block, in place (mid = (l + r) / 2, side = (l - r) / 2)
+//the MonoChain engine's passes either side of the filters, the VectorChain does this inside its own pass
+//three FloatVectorOperations passes each way, so no temporary buffer is needed
+template<typename SampleType>
+void encodeMidSide(juce::dsp::AudioBlock<SampleType>& block) {
+    auto* left = block.getChannelPointer(0);
+    auto* right = block.getChannelPointer(1);
+    auto numSamples = (int)block.getNumSamples();
+
+    //right = l - r, left = l - (l - r) / 2 = mid, right = side
+    juce::FloatVectorOperations::subtract(right, left, right, numSamples);
+    juce::FloatVectorOperations::addWithMultiply(left, right, static_cast<SampleType>(-0.5), numSamples);
+    juce::FloatVectorOperations::multiply(right, static_cast<SampleType>(0.5), numSamples);
+}
+
+template<typename SampleType>
+void decodeMidSide(juce::dsp::AudioBlock<SampleType>& block) {
+    auto* mid = block.getChannelPointer(0);
+    auto* side = block.getChannelPointer(1);
+    auto numSamples = (int)block.getNumSamples();
+
+    //mid = m + s = left, side = -2s + left = m - s = right
+    juce::FloatVectorOperations::add(mid, side, numSamples);
+    juce::FloatVectorOperations::multiply(side, static_cast<SampleType>(-2), numSamples);
+    juce::FloatVectorOperations::add(side, mid, numSamples);
+}
+
+
+//everything the IIR path needs at one sample type: the per channel chains for the MonoChain engine,
+//the vector chain and the oversamplers, all allocated in prepare()
+//the processor keeps a float and a double set and only keeps the one that's running up to date
+template<typename SampleType>
+struct FilterChains
+{
+    void prepare(const juce::dsp::ProcessSpec& spec, int numChannels, int samplesPerBlock, int maxOversamplingOrder)
+    {
+        //2x and 4x, each with polyphase IIR half-bands (low latency, not linear phase)
+        //and equiripple FIR half-bands (linear phase, more latency)
+        oversamplers.clear();
+        for (int order = 1; order <= maxOversamplingOrder; ++order)
+        {
+            for (auto filterType : { juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR,
+                                     juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple })
+            {
+                auto* oversampler = oversamplers.add(new juce::dsp::Oversampling<SampleType>((size_t)numChannels, (size_t)order, filterType, true));
+                oversampler->initProcessing((size_t)samplesPerBlock);
+            }
+        }
+        activeOversampler = nullptr;
+
+        //one mono chain per channel, pooled here so processBlock never has to allocate one
+        while (monoChains.size() < numChannels)
+            monoChains.add(new MonoChain<SampleType>());
+        monoChains.removeLast(monoChains.size() - numChannels);
+
+        for (auto* chain : monoChains)
+        {
+            prepareForInPlaceUpdates(*chain);
+            chain->prepare(spec);
+        }
+
+        while (extraBandChains.size() < numChannels)
+            extraBandChains.add(new ExtraBandChain<SampleType>());
+        extraBandChains.removeLast(extraBandChains.size() - numChannels);
+
+        for (auto* chain : extraBandChains)
+            chain->prepare(spec);
+
+        //the vector chain takes every channel, in groups of however many SIMD lanes we have
+        auto vectorSpec = spec;
+        vectorSpec.numChannels = (juce::uint32)numChannels;
+        vectorChain.prepare(vectorSpec);
+
+        //mixed precision with the MonoChain engine converts the block through here
+        conversionBuffer.setSize(numChannels, (int)spec.maximumBlockSize);
+    }
+
+    int getNumChannels() const { return monoChains.size(); }
+
+    void reset()
+    {
+        for (auto* chain : monoChains)
+            chain->reset();
+        for (auto* chain : extraBandChains)
+            chain->reset();
+        vectorChain.reset();
+        for (auto* oversampler : oversamplers)
+            oversampler->reset();
+    }
+
+    //clears the filter state of the given bands (ChainBands mask), in mid/side mode the side chain is left alone
+    void resetBands(int bands, bool midSide)
+    {
+        for (int ch = 0; ch < monoChains.size(); ++ch)
+            if (!(midSide && ch == sideChannel))
+                resetBandsOfChannel(ch, bands);
+        vectorChain.resetBands(bands, midSide ? VectorChain<SampleType>::midLanes : VectorChain<SampleType>::allLanes);
+    }
+
+    void resetSideBands(int bands)
+    {
+        if (sideChannel >= monoChains.size())
+            return;
+
+        resetBandsOfChannel(sideChannel, bands);
+        vectorChain.resetBands(bands, VectorChain<SampleType>::sideLane);
+    }
+
+    //picks one of the prebuilt oversamplers, order 0 is none
+    void selectOversampler(int order, int filterType)
+    {
+        activeOversampler = order > 0 ? oversamplers[(order - 1) * 2 + filterType] : nullptr;
+        if (activeOversampler != nullptr)
+            activeOversampler->reset();
+    }
+
+    //in mid/side mode channel 1 (lane 1) is the side chain, so the main set skips it
+    void applyCoefficients(const ChainCoefficients& chainCoefficients, int bandsToApply, bool midSide)
+    {
+        for (int ch = 0; ch < monoChains.size(); ++ch)
+        {
+            if (midSide && ch == sideChannel)
+                continue;
+
+            applyChainCoefficients(*monoChains.getUnchecked(ch), chainCoefficients, bandsToApply);
+            extraBandChains.getUnchecked(ch)->setCoefficients(chainCoefficients, bandsToApply);
+        }
+        vectorChain.setCoefficients(chainCoefficients, bandsToApply, midSide ? VectorChain<SampleType>::midLanes : VectorChain<SampleType>::allLanes);
+    }
+
+    void applySideCoefficients(const ChainCoefficients& sideCoefficients, int bandsToApply)
+    {
+        if (sideChannel >= monoChains.size())
+            return;
+
+        applyChainCoefficients(*monoChains.getUnchecked(sideChannel), sideCoefficients, bandsToApply);
+        extraBandChains.getUnchecked(sideChannel)->setCoefficients(sideCoefficients, bandsToApply);
+        vectorChain.setCoefficients(sideCoefficients, bandsToApply, VectorChain<SampleType>::sideLane);
+    }
+
+    //in mid/side mode the dynamic peak works on the mid channel only
+    void applyPeak(const BiquadCoefficients<double>& peak, bool midSide)
+    {
+        for (int ch = 0; ch < monoChains.size(); ++ch)
+            if (!(midSide && ch == sideChannel))
+                updateCoefficients(monoChains.getUnchecked(ch)->template get<ChainPositions::Peak>().coefficients, peak);
+        vectorChain.setPeakCoefficients(peak, midSide ? VectorChain<SampleType>::midLanes : VectorChain<SampleType>::allLanes);
+    }
+
+    void setMidSide(bool midSide) { vectorChain.setMidSide(midSide); }
+
+    //IOType is the block's sample type, a float block can run through double chains (mixed precision)
+    template<typename IOType>
+    void process(juce::dsp::AudioBlock<IOType>& block, bool useVectorChain, bool midSide)
+    {
+        if (useVectorChain)
+        {
+            //neighbouring channels share one pass through the cascade, converting as they're gathered
+            juce::dsp::ProcessContextReplacing<IOType> context(block);
+            vectorChain.process(context);
+        }
+        else if constexpr (std::is_same_v<IOType, SampleType>)
+        {
+            processMonoChains(block, midSide);
+        }
+        else
+        {
+            auto numChannels = block.getNumChannels();
+            auto numSamples = block.getNumSamples();
+            jassert(numSamples <= (size_t)conversionBuffer.getNumSamples());
+
+            juce::dsp::AudioBlock<SampleType> converted(conversionBuffer);
+            converted = converted.getSubsetChannelBlock(0, numChannels).getSubBlock(0, numSamples);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                std::copy(block.getChannelPointer(ch), block.getChannelPointer(ch) + numSamples, converted.getChannelPointer(ch));
+
+            processMonoChains(converted, midSide);
+
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                std::copy(converted.getChannelPointer(ch), converted.getChannelPointer(ch) + numSamples, block.getChannelPointer(ch));
+        }
+    }
+
+    juce::dsp::Oversampling<SampleType>* getOversampler() const { return activeOversampler; }
+
+    static constexpr int sideChannel = 1;
+
+private:
+    void resetBandsOfChannel(int channel, int bands)
+    {
+        auto& chain = *monoChains.getUnchecked(channel);
+        auto resetCutFilter = [](CutFilter<SampleType>& cutFilter)
+        {
+            cutFilter.template get<0>().reset();
+            cutFilter.template get<1>().reset();
+            cutFilter.template get<2>().reset();
+            cutFilter.template get<3>().reset();
+        };
+
+        if (bands & ChainBands::LowCutBand)
+            resetCutFilter(chain.template get<ChainPositions::LowCut>());
+        if (bands & ChainBands::PeakBand)
+            chain.template get<ChainPositions::Peak>().reset();
+        if (bands & ChainBands::HighCutBand)
+            resetCutFilter(chain.template get<ChainPositions::HighCut>());
+        extraBandChains.getUnchecked(channel)->resetBands(bands);
+    }
+
+    void processMonoChains(juce::dsp::AudioBlock<SampleType>& block, bool midSide)
+    {
+        //the vector chain does this inside its filter pass, here it's a pass of its own either side
+        if (midSide)
+            encodeMidSide(block);
+
+        for (size_t ch = 0; ch < block.getNumChannels(); ++ch)
+        {
+            auto channelBlock = block.getSingleChannelBlock(ch);
+            juce::dsp::ProcessContextReplacing<SampleType> context(channelBlock);
+            monoChains.getUnchecked((int)ch)->process(context);
+            extraBandChains.getUnchecked((int)ch)->process(context);
+        }
+
+        if (midSide)
+            decodeMidSide(block);
+    }
+
+    juce::OwnedArray<MonoChain<SampleType>> monoChains;
+    juce::OwnedArray<ExtraBandChain<SampleType>> extraBandChains;
+    VectorChain<SampleType> vectorChain;
+    //one oversampler per factor and filter type, all built in prepare() so switching never allocates
+    //indexed by (order - 1) * 2 + filter type
+    juce::OwnedArray<juce::dsp::Oversampling<SampleType>> oversamplers;
+    juce::dsp::Oversampling<SampleType>* activeOversampler = nullptr;
+    juce::AudioBuffer<SampleType> conversionBuffer;
+};
+
+
+//designs ChainCoefficients on a background thread whenever the tracker reports a change
+//and publishes finished sets through a LatestValue mailbox for the audio thread to pick up
+class CoefficientDesigner : juce::Thread
+{
+public:
+    CoefficientDesigner(ChainSettingsTracker& tracker);
+    ~CoefficientDesigner() override;
+
+    //stops the worker, designs every band for the new sample rate on the calling thread, then restarts the worker
+    //the cut table gets (re)built for the new rate in here too, while nobody is reading it
+    void prepare(double sampleRate, int maxOversamplingOrder);
+    void release();
+
+    //wake the worker up early instead of waiting for the next poll
+    void triggerRedesign() { notify(); }
+
+    //called with every freshly designed main set, on the worker (or in prepare(), on the calling thread)
+    std::function<void(const ChainCoefficients&)> onSetDesigned;
+
+    //audio thread: true if a newer pair of sets got published since the last call
+    bool pullLatest() { return mailbox.pull(); }
+    const ChainCoefficients& getLatest() const { return mailbox.getReadBuffer().main; }
+    //what the side channel runs in mid/side mode
+    const ChainCoefficients& getLatestSide() const { return mailbox.getReadBuffer().side; }
+    //read only between prepare() calls, so any thread can design cuts from it
+    const CutFilterTable& getCutTable() const { return cutTable; }
+    //how long the latest sets keep ringing once the input stops (the longer of main and side)
+    double getLatestTailSeconds() const { return mailbox.getReadBuffer().tailSeconds; }
+    double getLatestSilenceSeconds() const { return mailbox.getReadBuffer().silenceSeconds; }
+    //the tracker versions (see ChainSettingsTracker::getVersion) the latest sets were designed from
+    const std::array<juce::uint32, numChainBands>& getLatestSettingsVersions() const { return mailbox.getReadBuffer().settingsVersions; }
+
+    //tail: down 100dB, what the host gets told
+    //silence: far enough below the denormal threshold (with room for a boosted filter state) that clearing the state changes nothing
+    static constexpr double tailLevel = 1.0e-5;
+    static constexpr double silenceLevel = std::numeric_limits<float>::min() * 1.0e-3;
+
+private:
+    void run() override;
+    void designAndPublish(const ChainSettings& chainSettings, const ChainSettings& sideSettings, int bandsToDesign);
+
+    ChainSettingsTracker& tracker;
+    double sampleRate = 44100.0;
+    CutFilterTable cutTable;
+
+    struct DesignedSets
+    {
+        ChainCoefficients main, side;
+        double tailSeconds = 0.0, silenceSeconds = 0.0;
+        std::array<juce::uint32, numChainBands> settingsVersions{};
+    };
+
+    //bands get redesigned in here, then both sets are published together
+    DesignedSets designed;
+    LatestValue<DesignedSets> mailbox;
+
+    //host automation arrives on the audio thread and doesn't wake us up, so poll as well
+    static constexpr int pollIntervalMs = 5;
+};
+
 
 
 
@@ -245,7 +914,9 @@ inline auto makeHighCutFilter(const ChainSettings& chainSettings, double sampleR
 //==============================================================================
 /**
 */
-class RomalEQAudioProcessor  : public juce::AudioProcessor
+class RomalEQAudioProcessor  : public juce::AudioProcessor,
+                               private juce::Timer,
+                               private juce::AudioProcessorValueTreeState::Listener
 {
 public:
     //==============================================================================
@@ -261,6 +932,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -290,24 +963,236 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo { Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo {  Channel::Right };
+    SingleChannelSampleFifo leftChannelFifo { Channel::Left };
+    SingleChannelSampleFifo rightChannelFifo {  Channel::Right };
+
+    //both engines are always kept up to date, so they can be A/B'd at any time (the benchmark app's "engine" group times both)
+    enum ProcessingEngine {
+        MonoChainEngine,    //one MonoChain per channel, one juce::dsp::IIR::Filter per stage
+        VectorChainEngine   //all channels in SIMD lanes of a single cascade
+    };
+    void setProcessingEngine(ProcessingEngine engine) { processingEngine.store(engine); }
+    ProcessingEngine getProcessingEngine() const { return processingEngine.load(); }
+
+    //the analyzer fifos only get fed while something is showing the analysis
+    //switching it on drops whatever was left in the fifos from last time, so the analyzer starts from fresh samples
+    void setAnalyzerTapEnabled(bool shouldBeEnabled)
+    {
+        if (shouldBeEnabled && !analyzerTapEnabled.load())
+        {
+            leftChannelFifo.discardPending();
+            rightChannelFifo.discardPending();
+        }
+        analyzerTapEnabled.store(shouldBeEnabled);
+    }
 
 
 private:
 
         //enums and type aliases moved outside class
 
-        MonoChain leftChain, rightChain;
-
-        void updatePeakFilter(const ChainSettings& chainSettings);
+        //one set of chains per sample type, sized in prepareToPlay
+        FilterChains<float> floatChains;
+        FilterChains<double> doubleChains;
+        //3rd order ambisonics (16 channels) is the widest layout isBusesLayoutSupported takes
+        static constexpr int maxAmbisonicOrder = 3;
+        std::atomic<ProcessingEngine> processingEngine{ VectorChainEngine };
+
+        //double I/O always filters in double, float I/O does when "Filter Precision" asks for it (mixed mode)
+        //only the chains in use get coefficient updates, the others catch up in full when they take over
+        std::atomic<float>* filterPrecisionParameter = apvts.getRawParameterValue("Filter Precision");
+        bool doubleFiltersActive = false;
+        void setDoubleFiltersActive(bool shouldBeActive);
+
+        template<typename Function>
+        void forActiveChains(Function&& function)
+        {
+            if (doubleFiltersActive)
+                function(doubleChains);
+            else
+                function(floatChains);
+        }
 
+        template<typename SampleType>
+        FilterChains<SampleType>& getChainsForSampleType()
+        {
+            if constexpr (std::is_same_v<SampleType, double>)
+                return doubleChains;
+            else
+                return floatChains;
+        }
 
-        void updateLowCutFilters(const ChainSettings& chainSettings);
-        void updateHighCutFilters(const ChainSettings& chainSettings);
+        //processBlock for either precision
+        template<typename SampleType>
+        void processSamples(juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages);
 
-        void updateFilters();
+        //what the start of the block decided, for the helpers that run it
+        struct BlockPlan
+        {
+            //0 when smoothing is off
+            int subBlockSize = 0;
+            bool ramp = false, dynamic = false, sideFade = false, fade = false;
+        };
+        //picks up parameters, modes and the designer's latest set, and works out how the block has to run
+        template<typename SampleType>
+        BlockPlan planBlock(const juce::MidiBuffer& midiMessages, int numChannels);
+        void pickUpDesignedSet(bool ramp);
+        bool updateDynamics(bool ramp);
+
+        //splits the block at events, smoothing sub-blocks and control intervals, and runs each segment
+        template<typename SampleType>
+        void processSegments(juce::dsp::AudioBlock<SampleType>& block, BlockPlan& plan);
+        void applyEventsUpTo(int position, int& nextEvent, BlockPlan& plan);
+        //steps ramps and fades on by length samples, applies what changed, returns the set the segment runs
+        const ChainCoefficients& advanceSegment(int length, const BlockPlan& plan);
+        template<typename SampleType>
+        void applyDynamics(const juce::dsp::AudioBlock<SampleType>& segment, const ChainCoefficients& segmentCoefficients);
+
+        //applies the bands of a designed set whose versions differ from what the chains already run
+        void updateFilters(const ChainCoefficients& chainCoefficients);
+        void updateSideFilters(const ChainCoefficients& sideCoefficients);
+        static int takeChangedBands(const ChainCoefficients& chainCoefficients, std::array<juce::uint32, numChainBands>& appliedVersions);
+        std::array<juce::uint32, numChainBands> appliedBandVersions{}, appliedSideBandVersions{};
+
+        //the main set the chains should be running: the designer's, unless parameter events moved bands it hasn't caught up with
+        const ChainCoefficients& getMainCoefficients() const;
+
+        //sample accurate parameter changes: MIDI CCs mapped to the core band parameters ("CC Peak Freq" etc, 0 = not mapped)
+        //the block gets split at their timestamps, and those bands are designed on the audio thread (closed form, allocation free)
+        //host automation only ever arrives once per block, for that the smoothing ramp is the answer
+        struct CCMapping
+        {
+            juce::String parameterID;
+            float ChainSettings::* setting;
+            int position;
+            std::atomic<float>* controllerNumber = nullptr;
+            juce::RangedAudioParameter* parameter = nullptr;
+            //normalised value the block ended on, < 0 if no event touched it
+            float pendingValue = -1.f;
+        };
+        std::array<CCMapping, 5> ccMappings{ {
+            { "LowCut Freq", &ChainSettings::lowCutFreq, ChainPositions::LowCut },
+            { "Peak Freq", &ChainSettings::peakFreq, ChainPositions::Peak },
+            { "Peak Gain", &ChainSettings::peakGainInDecibels, ChainPositions::Peak },
+            { "Peak Quality", &ChainSettings::peakQuality, ChainPositions::Peak },
+            { "HighCut Freq", &ChainSettings::highCutFreq, ChainPositions::HighCut } } };
+
+        struct ParameterEvent
+        {
+            int samplePosition;
+            int mapping;
+            float value;
+        };
+        //fixed size so collecting never allocates, a block with more events than this keeps the last ones
+        static constexpr int maxParameterEvents = 128;
+        std::array<ParameterEvent, maxParameterEvents> parameterEvents;
+        int numParameterEvents = 0;
+        void collectParameterEvents(const juce::MidiBuffer& midiMessages);
+        //returns the ChainBands bit of the band it moved
+        int applyParameterEvent(const ParameterEvent& event);
+
+        //settings and set the events are designed into, eventCoefficients is the main set while any band is held
+        ChainSettings eventSettings;
+        ChainCoefficients eventCoefficients;
+        void beginParameterEvents();
+
+        //the block's final values go to the parameters, so the UI, the host and the designer follow
+        //setValueNotifyingHost calls the host and every listener straight away, so the values are queued here
+        //and the message thread (timerCallback) sets them
+        //the bands stay held until their values are set and the designer publishes a set designed from them,
+        //so nothing jumps back in between
+        void queueParameterEvents();
+        void timerCallback() override;
+        //the timer only runs while some CC is mapped (and until whatever was queued before unmapping is set)
+        //the mappings are watched for changes on the message thread, which is where the editor and restored state set them
+        void parameterChanged(const juce::String& parameterID, float newValue) override;
+        bool isAnyControllerMapped() const;
+        void updateParameterTimer();
+        ParameterValueQueue parameterValueQueue;
+        int heldBands = 0;
+        //returns the bands that got released, their designer coefficients need applying
+        int releaseHeldBands();
+
+        //"Min Segment Length": events closer together than this are applied together, which bounds the cost
+        int getMinimumSegmentLength() const;
+        std::atomic<float>* minimumSegmentParameter = apvts.getRawParameterValue("Min Segment Length");
+
+        //runs the block through the oversampler (if any) and whichever engine is selected
+        template<typename SampleType>
+        void processChains(juce::dsp::AudioBlock<SampleType>& block);
+        template<typename SampleType>
+        void processEngine(juce::dsp::AudioBlock<SampleType>& block);
+        void applyToChains(const ChainCoefficients& chainCoefficients, int bandsToApply);
+        void applySideToChains(const ChainCoefficients& sideCoefficients, int bandsToApply);
+        void resetChains();
+
+        //"Stereo Mode": L/R linked, or mid/side with the side channel running its own lowcut, peak and highcut
+        //channel 1's chains (lane 1 of the vector chain) become the side chain, channel 0's the mid chain
+        std::atomic<float>* stereoModeParameter = apvts.getRawParameterValue("Stereo Mode");
+        bool midSideActive = false;
+        void setMidSideActive(bool shouldBeActive);
+
+        //bands switching on or off (bypass, or moving to / from a setting where they do nothing) fade instead
+        //fades run in control intervals, each one applying the faded set for the bands involved
+        BandFader mainFader, sideFader;
+        ChainCoefficients fadedCoefficients, fadedSideCoefficients;
+        static constexpr double bandFadeSeconds = 0.01;
+        void startFades();
+
+        //nothing on, nothing fading and nothing adding latency: the block is left untouched
+        bool isIdle() const;
+
+        //the editor says when it wants analyzer data, otherwise the fifos aren't fed at all
+        std::atomic<bool> analyzerTapEnabled{ false };
+
+        //the state gets cleared going to sleep, which by then changes nothing, so waking up is exact
+        SilenceDetector silenceDetector;
+        int getSilenceSamples() const;
+
+        //worked out on the audio thread from whatever is running, read by the host from anywhere
+        void updateTailLength();
+        std::atomic<double> tailLengthSeconds{ 0.0 };
+
+        //"Smoothing" parameter: 0 when off, otherwise the sub-block length coefficients get re-derived at
+        int getSmoothingSubBlockSize() const;
+        std::atomic<float>* smoothingParameter = apvts.getRawParameterValue("Smoothing");
+        ChainSettingsSmoother chainSmoother;
+        ChainCoefficients smoothedCoefficients;
+        bool smoothingWasEnabled = false;
+        static constexpr double smoothingRampSeconds = 0.05;
+
+        //the oversamplers live in the filter chains, one per factor and filter type
+        static constexpr int maxOversamplingOrder = 2;
+
+        //the factor follows the coefficient set being run, the filter type comes straight from its parameter
+        void updateOversampling(int newOrder, int newFilterType);
+        int oversamplingOrder = 0, oversamplingFilterType = 0;
+        std::atomic<float>* oversamplingFilterParameter = apvts.getRawParameterValue("Oversampling Filter");
+
+        //"Phase Mode": the IIR chains above, or the whole EQ as one linear phase FIR
+        //the designer thread builds the kernels, the audio thread only convolves and crossfades
+        LinearPhaseEngine linearPhaseEngine;
+        std::atomic<float>* phaseModeParameter = apvts.getRawParameterValue("Phase Mode");
+        bool linearPhaseActive = false;
+        void setLinearPhaseActive(bool shouldBeActive);
+
+        //dynamic peak: the detector runs once per control interval and only re-gains the peak, no redesign
+        PeakDynamics peakDynamics;
+        std::atomic<float>* peakDynamicParameter = apvts.getRawParameterValue("Peak Dynamic");
+        std::atomic<float>* peakThresholdParameter = apvts.getRawParameterValue("Peak Threshold");
+        std::atomic<float>* peakRatioParameter = apvts.getRawParameterValue("Peak Ratio");
+        std::atomic<float>* peakAttackParameter = apvts.getRawParameterValue("Peak Attack");
+        std::atomic<float>* peakReleaseParameter = apvts.getRawParameterValue("Peak Release");
+        bool dynamicWasActive = false;
+        //dynamics and band fades both re-derive coefficients this often
+        static constexpr int controlInterval = 16;
+        void applyPeakToChains(const BiquadCoefficients<double>& peak);
+
+        //whatever is running decides the latency: the linear phase engine, or the oversampler (if any)
+        void updateLatency();
+
+        ChainSettingsTracker chainSettingsTracker{ apvts };
+        CoefficientDesigner coefficientDesigner{ chainSettingsTracker };
 
         //produce a sin wave on our grid to debug FFT visualizer?
         juce::dsp::Oscillator<float> osc;
@@ -0,0 +1,90 @@
+/*
+  ==============================================================================
+
+    SampleRing: single producer / single consumer ring of float samples.
+
+    The writer copies spans in (narrowing double input on the way), the reader
+    gets a view of the samples where they sit in the ring, as one span or two
+    when the range wraps around the end. Nothing allocates after prepare().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <vector>
+
+class SampleRing
+{
+public:
+    //up to two spans, the second one only when the range wraps
+    struct ReadView
+    {
+        const float* data1 = nullptr;
+        int size1 = 0;
+        const float* data2 = nullptr;
+        int size2 = 0;
+
+        int getNumSamples() const { return size1 + size2; }
+
+        void copyTo(float* destination) const
+        {
+            juce::FloatVectorOperations::copy(destination, data1, size1);
+            if (size2 > 0)
+                juce::FloatVectorOperations::copy(destination + size1, data2, size2);
+        }
+    };
+
+    //allocates, call it while neither side is running
+    void prepare(int capacity)
+    {
+        //AbstractFifo keeps one slot free to tell full from empty
+        samples.assign((size_t)capacity + 1, 0.f);
+        fifo.setTotalSize(capacity + 1);
+        fifo.reset();
+    }
+
+    //producer: copies in as much as fits, returns how much that was (a full ring drops the rest)
+    template<typename SampleType>
+    int write(const SampleType* source, int numSamples)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        copyIn(source, samples.data() + start1, size1);
+        copyIn(source + size1, samples.data() + start2, size2);
+
+        fifo.finishedWrite(size1 + size2);
+        return size1 + size2;
+    }
+
+    //consumer: the oldest numSamples (or fewer, if that's all there is), valid until finishedReading()
+    ReadView getReadView(int numSamples) const
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+        return { samples.data() + start1, size1, samples.data() + start2, size2 };
+    }
+
+    void finishedReading(int numSamples) { fifo.finishedRead(numSamples); }
+
+    int getNumReady() const { return fifo.getNumReady(); }
+
+private:
+    template<typename SampleType>
+    static void copyIn(const SampleType* source, float* destination, int numSamples)
+    {
+        if (numSamples <= 0)
+            return;
+
+        if constexpr (std::is_same_v<SampleType, float>)
+            juce::FloatVectorOperations::copy(destination, source, numSamples);
+        else
+            std::transform(source, source + numSamples, destination, [](SampleType x) { return static_cast<float>(x); });
+    }
+
+    std::vector<float> samples;
+    juce::AbstractFifo fifo{ 1 };
+};
@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    SpectrumBallistics: what happens to an analyzer spectrum (in decibels)
+    between the FFT and the path.
+
+    Optional fractional octave smoothing, then peak hold with a linear decay,
+    then exponential averaging of power (not decibels, which would settle a
+    noisy spectrum below its level). The time constants are in seconds of
+    audio, not frames, so they hold whatever the fft size, overlap or frame rate.
+    Everything runs in place on buffers sized in prepare().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+#include <vector>
+
+class SpectrumBallistics
+{
+public:
+    struct Settings
+    {
+        //0 = off, the spectrum is shown as it comes in
+        float averagingSeconds = 0.f;
+        //0 = no peak hold
+        float peakDecayDecibelsPerSecond = 0.f;
+        //smoothing bandwidth in octaves, 0 = off
+        float smoothingOctaves = 0.f;
+    };
+
+    //allocates, call it before anything else
+    void prepare(int maxNumBins)
+    {
+        averagedPower.assign((size_t)maxNumBins, 0.f);
+        peaks.assign((size_t)maxNumBins, 0.f);
+        prefixSums.assign((size_t)maxNumBins + 1, 0.0);
+        smoothingRanges.assign((size_t)maxNumBins, {});
+        numBins = 0;
+    }
+
+    void setSettings(const Settings& newSettings)
+    {
+        //held peaks that decayed at another rate don't mean anything at this one, start them over from the next frame
+        if (newSettings.peakDecayDecibelsPerSecond != settings.peakDecayDecibelsPerSecond)
+            restartPeaks = true;
+        settings = newSettings;
+    }
+    const Settings& getSettings() const { return settings; }
+    bool isPeakHoldEnabled() const { return settings.peakDecayDecibelsPerSecond > 0.f; }
+
+    //spectrum holds newNumBins decibel values and gets replaced by the averaged ones
+    //elapsedSeconds: how much audio went by since the previous frame
+    void process(float* spectrum, int newNumBins, double elapsedSeconds, float negativeInfinity)
+    {
+        jassert(newNumBins <= (int)averagedPower.size());
+
+        if (settings.smoothingOctaves > 0.f)
+            smooth(spectrum, newNumBins);
+
+        //a different fft order puts different frequencies in each bin, so start over from this frame
+        if (newNumBins != numBins)
+        {
+            numBins = newNumBins;
+            restartPeaks = true;
+            restartAverage = true;
+        }
+
+        //peaks and the average only get updated while they're on, so they start over from the frame they come back on
+        if (isPeakHoldEnabled())
+        {
+            if (restartPeaks)
+            {
+                juce::FloatVectorOperations::copy(peaks.data(), spectrum, numBins);
+                restartPeaks = false;
+            }
+            else
+            {
+                auto decay = (float)(settings.peakDecayDecibelsPerSecond * elapsedSeconds);
+                juce::FloatVectorOperations::add(peaks.data(), -decay, numBins);
+                juce::FloatVectorOperations::max(peaks.data(), peaks.data(), spectrum, numBins);
+                juce::FloatVectorOperations::max(peaks.data(), peaks.data(), negativeInfinity, numBins);
+            }
+        }
+        else
+        {
+            restartPeaks = true;
+        }
+
+        if (settings.averagingSeconds > 0.f)
+        {
+            if (restartAverage)
+            {
+                for (int bin = 0; bin < numBins; ++bin)
+                    averagedPower[(size_t)bin] = decibelsToPower(spectrum[bin]);
+                restartAverage = false;
+                return;
+            }
+
+            //one pole with time constant averagingSeconds, spread over however long this frame took
+            auto keep = (float)std::exp(-elapsedSeconds / settings.averagingSeconds);
+            for (int bin = 0; bin < numBins; ++bin)
+            {
+                auto& power = averagedPower[(size_t)bin];
+                power = keep * power + (1.f - keep) * decibelsToPower(spectrum[bin]);
+                spectrum[bin] = juce::jmax(negativeInfinity, 10.f * std::log10(power));
+            }
+        }
+        else
+        {
+            restartAverage = true;
+        }
+    }
+
+    //valid for the numBins of the last process() call
+    const std::vector<float>& getPeaks() const { return peaks; }
+
+private:
+    //the spectrum is 20 log10 of a magnitude, so this is the magnitude squared
+    static float decibelsToPower(float decibels) { return std::pow(10.f, 0.1f * decibels); }
+
+    //each bin becomes the mean of the bins within smoothingOctaves / 2 either side of it, via prefix sums
+    void smooth(float* spectrum, int numBinsToSmooth)
+    {
+        if (numBinsToSmooth != rangesNumBins || settings.smoothingOctaves != rangesOctaves)
+            buildSmoothingRanges(numBinsToSmooth);
+
+        prefixSums[0] = 0.0;
+        for (int bin = 0; bin < numBinsToSmooth; ++bin)
+            prefixSums[(size_t)bin + 1] = prefixSums[(size_t)bin] + spectrum[bin];
+
+        for (int bin = 0; bin < numBinsToSmooth; ++bin)
+        {
+            const auto& range = smoothingRanges[(size_t)bin];
+            spectrum[bin] = (float)((prefixSums[(size_t)range.last + 1] - prefixSums[(size_t)range.first]) / (range.last - range.first + 1));
+        }
+    }
+
+    //only when the fft order or the smoothing width changes, doesn't allocate
+    void buildSmoothingRanges(int numBinsToSmooth)
+    {
+        rangesNumBins = numBinsToSmooth;
+        rangesOctaves = settings.smoothingOctaves;
+
+        auto ratio = std::exp2(0.5 * rangesOctaves);
+        for (int bin = 0; bin < numBinsToSmooth; ++bin)
+        {
+            auto& range = smoothingRanges[(size_t)bin];
+            range.first = juce::jlimit(0, bin, (int)std::ceil(bin / ratio));
+            range.last = juce::jlimit(bin, numBinsToSmooth - 1, (int)std::floor(bin * ratio));
+        }
+    }
+
+    struct BinRange
+    {
+        int first = 0, last = 0;
+    };
+
+    Settings settings;
+    int numBins = 0;
+    //linear power, not decibels
+    std::vector<float> averagedPower, peaks;
+    bool restartPeaks = true, restartAverage = true;
+
+    std::vector<double> prefixSums;
+    std::vector<BinRange> smoothingRanges;
+    int rangesNumBins = 0;
+    float rangesOctaves = 0.f;
+};
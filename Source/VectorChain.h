@@ -0,0 +1,368 @@
+/*
+  ==============================================================================
+
+    VectorChain: the same lowcut -> peak -> extra bands -> highcut cascade, but
+    with every channel living in its own lane of a SIMD register, so one pass
+    through the biquads filters all channels at once.
+
+    Coefficients and filter state are stored as flat arrays with one slot per
+    possible stage. Only the active slots (kept in a list that is rebuilt when
+    a band changes) get gathered into the fused kernel. Short cascades get a
+    kernel per stage count with the stage loop unrolled, longer ones share a
+    kernel that loops over however many stages are active.
+
+    Any number of channels is handled by splitting them into groups of
+    numLanes, each group with its own filter state, preallocated in prepare().
+
+    Coefficients can differ per lane, which is how mid/side works: the stereo
+    pair is encoded to M/S while it's gathered into the frame, lane 0 runs
+    the mid coefficients, lane 1 the side ones, and it's decoded again on the
+    way out, all inside the same pass.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <utility>
+#include "ChainCoefficients.h"
+
+#if JUCE_USE_SIMD
+template<typename SampleType>
+using LaneRegister = juce::dsp::SIMDRegister<SampleType>;
+#else
+//scalar stand in for juce::dsp::SIMDRegister on platforms without SIMD support
+//two lanes so a stereo pair still shares a single pass through the cascade
+template<typename SampleType>
+struct LaneRegister
+{
+    static constexpr size_t SIMDNumElements = 2;
+    std::array<SampleType, SIMDNumElements> lanes;
+
+    static LaneRegister expand(SampleType value) { return { { value, value } }; }
+    static LaneRegister fromRawArray(const SampleType* a) { return { { a[0], a[1] } }; }
+    void copyToRawArray(SampleType* a) const { a[0] = lanes[0]; a[1] = lanes[1]; }
+    SampleType get(size_t lane) const { return lanes[lane]; }
+    void set(size_t lane, SampleType value) { lanes[lane] = value; }
+    static SampleType* getNextSIMDAlignedPtr(SampleType* ptr) { return ptr; }
+
+    LaneRegister operator+(const LaneRegister& o) const { return { { lanes[0] + o.lanes[0], lanes[1] + o.lanes[1] } }; }
+    LaneRegister operator-(const LaneRegister& o) const { return { { lanes[0] - o.lanes[0], lanes[1] - o.lanes[1] } }; }
+    LaneRegister operator*(const LaneRegister& o) const { return { { lanes[0] * o.lanes[0], lanes[1] * o.lanes[1] } }; }
+};
+#endif
+
+template<typename SampleType>
+class VectorChain
+{
+public:
+    using Register = LaneRegister<SampleType>;
+    static constexpr size_t numLanes = Register::SIMDNumElements;
+
+    //bit n selects lane n
+    using LaneMask = juce::uint32;
+    static constexpr LaneMask allLanes = (LaneMask(1) << numLanes) - 1;
+    static constexpr LaneMask sideLane = LaneMask(1) << 1;
+    static constexpr LaneMask midLanes = allLanes & ~sideLane;
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        //e.g. a 16 channel ambisonic stem at 4 lanes is 4 groups, mono still needs one
+        auto numGroups = (static_cast<size_t>(spec.numChannels) + numLanes - 1) / numLanes;
+        groupStates.resize(juce::jmax(static_cast<size_t>(1), numGroups));
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& states : groupStates)
+        {
+            states.s1.fill(Register::expand(0));
+            states.s2.fill(Register::expand(0));
+        }
+    }
+
+    //copies the requested bands (ChainBands mask) into the given lanes
+    void setCoefficients(const ChainCoefficients& chainCoefficients, int bandsToApply, LaneMask lanes = allLanes)
+    {
+        if (bandsToApply & ChainBands::LowCutBand)
+            setCutStages(lowCutOffset, chainCoefficients.lowCut, chainCoefficients.lowCutSlope, chainCoefficients.lowCutBypassed, lanes);
+
+        if (bandsToApply & ChainBands::PeakBand)
+            setStage(peakOffset, chainCoefficients.peak, !chainCoefficients.peakBypassed, lanes);
+
+        for (int i = 0; i < maxExtraBands; ++i)
+        {
+            if (bandsToApply & getExtraBandBit(i))
+                setStage(extraBandOffset + (size_t)i, chainCoefficients.extraBands[(size_t)i],
+                         chainCoefficients.extraBandActive[(size_t)i], lanes);
+        }
+
+        if (bandsToApply & ChainBands::HighCutBand)
+            setCutStages(highCutOffset, chainCoefficients.highCut, chainCoefficients.highCutSlope, chainCoefficients.highCutBypassed, lanes);
+
+        updateActiveStages();
+    }
+
+    //just the peak's coefficients, bypass and the active list stay as they are (dynamic peak)
+    void setPeakCoefficients(const BiquadCoefficients<double>& peak, LaneMask lanes = allLanes)
+    {
+        //lanes where the peak is bypassed keep running it as unity
+        setLanes(peakOffset, peak, lanes & stageLanes[peakOffset]);
+    }
+
+    //clears the filter state of the given bands (ChainBands mask), e.g. before one fades back in
+    void resetBands(int bands, LaneMask lanes = allLanes)
+    {
+        for (auto& states : groupStates)
+        {
+            auto clear = [&states, lanes](size_t slot)
+            {
+                clearLanes(states.s1[slot], lanes);
+                clearLanes(states.s2[slot], lanes);
+            };
+
+            if (bands & ChainBands::LowCutBand)
+                for (size_t i = 0; i < ChainCoefficients::maxCutStages; ++i)
+                    clear(lowCutOffset + i);
+            if (bands & ChainBands::PeakBand)
+                clear(peakOffset);
+            for (int i = 0; i < maxExtraBands; ++i)
+                if (bands & getExtraBandBit(i))
+                    clear(extraBandOffset + (size_t)i);
+            if (bands & ChainBands::HighCutBand)
+                for (size_t i = 0; i < ChainCoefficients::maxCutStages; ++i)
+                    clear(highCutOffset + i);
+        }
+    }
+
+    //encode the first two channels to mid/side on the way in and decode on the way out
+    //only meaningful for a stereo block, lane 1 then carries the side channel
+    void setMidSide(bool shouldBeMidSide) { midSide = shouldBeMidSide; }
+
+    //IOType is the block's sample type, a float block through a double chain converts
+    //on the way into and out of the registers, so mixed precision costs no extra pass
+    template<typename IOType>
+    void process(const juce::dsp::ProcessContextReplacing<IOType>& context)
+    {
+        auto& block = context.getOutputBlock();
+        auto numChannels = block.getNumChannels();
+        jassert(numChannels <= groupStates.size() * numLanes);
+
+        //unrolled for short cascades, a runtime stage loop past maxUnrolledStages
+        auto kernel = getKernel<IOType>(numActiveStages, false);
+
+        size_t firstChannel = 0;
+        for (auto& states : groupStates)
+        {
+            if (firstChannel >= numChannels)
+                break;
+
+            auto numGroupChannels = juce::jmin(numLanes, numChannels - firstChannel);
+            auto groupKernel = (firstChannel == 0 && midSide && numGroupChannels >= 2) ? getKernel<IOType>(numActiveStages, true) : kernel;
+            (this->*groupKernel)(block, firstChannel, numGroupChannels, states);
+            firstChannel += numLanes;
+        }
+    }
+
+private:
+    //slots: 4 lowcut stages, the peak, the extra bands, 4 highcut stages
+    static constexpr size_t lowCutOffset = 0;
+    static constexpr size_t peakOffset = ChainCoefficients::maxCutStages;
+    static constexpr size_t extraBandOffset = peakOffset + 1;
+    static constexpr size_t highCutOffset = extraBandOffset + maxExtraBands;
+    static constexpr size_t numStages = highCutOffset + ChainCoefficients::maxCutStages;
+
+    //flat structure of arrays, one entry per slot, usually the same coefficients in every lane
+    struct StageCoefficients
+    {
+        std::array<Register, numStages> b0, b1, b2, a1, a2;
+    };
+
+    //transposed direct form II state, also one entry per slot so a band keeps its state while others come and go
+    struct GroupState
+    {
+        std::array<Register, numStages> s1, s2;
+    };
+
+    StageCoefficients stages;
+    std::vector<GroupState> groupStates;
+
+    //which lanes each slot is switched on in
+    std::array<LaneMask, numStages> stageLanes{};
+    bool midSide = false;
+
+    //the slots that actually run (on in at least one lane), in cascade order, rebuilt whenever a band changes
+    std::array<size_t, numStages> activeStages{};
+    size_t numActiveStages = 0;
+
+    void setLanes(size_t slot, const BiquadCoefficients<double>& c, LaneMask lanes)
+    {
+        if (lanes == allLanes)
+        {
+            stages.b0[slot] = Register::expand(static_cast<SampleType>(c.b0));
+            stages.b1[slot] = Register::expand(static_cast<SampleType>(c.b1));
+            stages.b2[slot] = Register::expand(static_cast<SampleType>(c.b2));
+            stages.a1[slot] = Register::expand(static_cast<SampleType>(c.a1));
+            stages.a2[slot] = Register::expand(static_cast<SampleType>(c.a2));
+            return;
+        }
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+        {
+            if ((lanes & (LaneMask(1) << lane)) == 0)
+                continue;
+
+            stages.b0[slot].set(lane, static_cast<SampleType>(c.b0));
+            stages.b1[slot].set(lane, static_cast<SampleType>(c.b1));
+            stages.b2[slot].set(lane, static_cast<SampleType>(c.b2));
+            stages.a1[slot].set(lane, static_cast<SampleType>(c.a1));
+            stages.a2[slot].set(lane, static_cast<SampleType>(c.a2));
+        }
+    }
+
+    static void clearLanes(Register& value, LaneMask lanes)
+    {
+        if (lanes == allLanes)
+        {
+            value = Register::expand(0);
+            return;
+        }
+
+        for (size_t lane = 0; lane < numLanes; ++lane)
+            if (lanes & (LaneMask(1) << lane))
+                value.set(lane, 0);
+    }
+
+    void setStage(size_t slot, const BiquadCoefficients<double>& c, bool active, LaneMask lanes)
+    {
+        //a lane where the stage is off runs it as unity, so it can still share the pass with lanes where it's on
+        setLanes(slot, active ? c : BiquadCoefficients<double>{}, lanes);
+        stageLanes[slot] = active ? (stageLanes[slot] | lanes) : (stageLanes[slot] & ~lanes);
+    }
+
+    void setCutStages(size_t offset, const std::array<BiquadCoefficients<double>, ChainCoefficients::maxCutStages>& cut,
+                      Slope slope, bool bypassed, LaneMask lanes)
+    {
+        auto numCutStages = bypassed ? 0 : static_cast<int>(slope) + 1;
+        for (size_t i = 0; i < ChainCoefficients::maxCutStages; ++i)
+            setStage(offset + i, cut[i], (int)i < numCutStages, lanes);
+    }
+
+    void updateActiveStages()
+    {
+        //slots are laid out in cascade order already
+        numActiveStages = 0;
+        for (size_t slot = 0; slot < numStages; ++slot)
+            if (stageLanes[slot] != 0)
+                activeStages[numActiveStages++] = slot;
+    }
+
+    //a kernel per stage count up to here: 7 registers a stage, so a few stages' worth fit in the register file
+    //and the unrolled loop keeps them there, longer cascades would only spill and bloat the code
+    static constexpr size_t maxUnrolledStages = 8;
+
+    //the fused kernel: every active stage runs on a sample before moving on to the next sample,
+    //so the block is read and written exactly once
+    //Unrolled: exactly Capacity stages, known at compile time, otherwise numActiveStages (up to Capacity) in a loop
+    template<size_t Capacity, bool Unrolled, bool MidSide, typename IOType>
+    void processFused(const juce::dsp::AudioBlock<IOType>& block, size_t firstChannel, size_t numChannels, GroupState& states)
+    {
+        const size_t numActive = Unrolled ? Capacity : numActiveStages;
+        jassert(numActive <= Capacity);
+
+        if constexpr (Unrolled && Capacity == 0)
+        {
+            juce::ignoreUnused(block, firstChannel, numChannels, states, numActive);
+        }
+        else
+        {
+            //gather the active slots into contiguous locals
+            std::array<Register, Capacity> b0, b1, b2, a1, a2, z1, z2;
+
+            for (size_t i = 0; i < numActive; ++i)
+            {
+                auto slot = activeStages[i];
+                b0[i] = stages.b0[slot];
+                b1[i] = stages.b1[slot];
+                b2[i] = stages.b2[slot];
+                a1[i] = stages.a1[slot];
+                a2[i] = stages.a2[slot];
+                z1[i] = states.s1[slot];
+                z2[i] = states.s2[slot];
+            }
+
+            std::array<IOType*, numLanes> channels{};
+            for (size_t ch = 0; ch < numChannels; ++ch)
+                channels[ch] = block.getChannelPointer(firstChannel + ch);
+
+            //one frame = one sample from every channel, unused lanes stay at zero
+            alignas(sizeof(Register)) SampleType frame[numLanes] = {};
+            auto numSamples = block.getNumSamples();
+
+            for (size_t n = 0; n < numSamples; ++n)
+            {
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    frame[ch] = static_cast<SampleType>(channels[ch][n]);
+
+                if constexpr (MidSide)
+                {
+                    auto left = frame[0], right = frame[1];
+                    frame[0] = static_cast<SampleType>(0.5) * (left + right);
+                    frame[1] = static_cast<SampleType>(0.5) * (left - right);
+                }
+
+                auto x = Register::fromRawArray(frame);
+
+                //transposed direct form II, output of each stage feeds the next
+                for (size_t i = 0; i < numActive; ++i)
+                {
+                    auto y = b0[i] * x + z1[i];
+                    z1[i] = b1[i] * x - a1[i] * y + z2[i];
+                    z2[i] = b2[i] * x - a2[i] * y;
+                    x = y;
+                }
+
+                x.copyToRawArray(frame);
+
+                if constexpr (MidSide)
+                {
+                    auto mid = frame[0], side = frame[1];
+                    frame[0] = mid + side;
+                    frame[1] = mid - side;
+                }
+
+                for (size_t ch = 0; ch < numChannels; ++ch)
+                    channels[ch][n] = static_cast<IOType>(frame[ch]);
+            }
+
+            for (size_t i = 0; i < numActive; ++i)
+            {
+                states.s1[activeStages[i]] = z1[i];
+                states.s2[activeStages[i]] = z2[i];
+            }
+        }
+    }
+
+    template<typename IOType>
+    using Kernel = void (VectorChain::*)(const juce::dsp::AudioBlock<IOType>&, size_t, size_t, GroupState&);
+
+    template<typename IOType, bool MidSide, size_t... Counts>
+    static constexpr std::array<Kernel<IOType>, sizeof...(Counts)> makeKernelTable(std::index_sequence<Counts...>)
+    {
+        return { { &VectorChain::processFused<Counts, true, MidSide, IOType>... } };
+    }
+
+    template<typename IOType>
+    static Kernel<IOType> getKernel(size_t numActive, bool withMidSide)
+    {
+        if (numActive > maxUnrolledStages)
+            return withMidSide ? &VectorChain::processFused<numStages, false, true, IOType>
+                               : &VectorChain::processFused<numStages, false, false, IOType>;
+
+        static constexpr auto kernels = makeKernelTable<IOType, false>(std::make_index_sequence<maxUnrolledStages + 1>());
+        static constexpr auto midSideKernels = makeKernelTable<IOType, true>(std::make_index_sequence<maxUnrolledStages + 1>());
+        return withMidSide ? midSideKernels[numActive] : kernels[numActive];
+    }
+};